@@ -0,0 +1,204 @@
+# -*- coding: utf-8 -*-
+"""
+Micro-benchmarks for fastnumbers.
+
+Run from the project root after building in-place, e.g.
+
+    python setup.py build_ext --inplace
+    PYTHONPATH=src python dev/benchmark.py [suite ...]
+
+Each suite times a conversion over a fixed list of generated inputs
+and reports throughput in millions of values per second next to the
+equivalent builtin, so that numbers from before and after a change
+can be compared directly.
+"""
+
+import argparse
+import collections
+import decimal
+import math
+import random
+import sys
+import timeit
+from functools import partial
+from typing import Callable, Dict, List, Sequence
+
+import fastnumbers
+
+N_VALUES = 10000
+N_REPEAT = 15
+
+
+def throughput(func: Callable[[str], object], values: Sequence[str]) -> float:
+    """Return the best-of-N throughput of func over values in Mvalues/s."""
+
+    def run() -> None:
+        collections.deque(map(func, values), maxlen=0)
+
+    best = min(timeit.repeat(run, number=1, repeat=N_REPEAT))
+    return len(values) / best / 1e6
+
+
+def report(label: str, values: Sequence[str], funcs: Dict[str, Callable]) -> None:
+    cells = ["{}={:7.2f}".format(k, throughput(f, values)) for k, f in funcs.items()]
+    print("  {:<28s} {}  (Mvalues/s)".format(label, "  ".join(cells)))
+
+
+def float_mantissa(ndigits: int, rng: random.Random) -> List[str]:
+    """Floats with exactly ndigits significant digits and a random exponent."""
+    out = []
+    for _ in range(N_VALUES):
+        digits = str(rng.randrange(10 ** (ndigits - 1), 10 ** ndigits))
+        out.append("{}.{}e{}".format(digits[0], digits[1:], rng.randint(-30, 30)))
+    return out
+
+
+def float_near_halfway(rng: random.Random) -> List[str]:
+    """Floats just off the midpoint of two doubles, needing all digits to round."""
+    ctx = decimal.Context(prec=40)
+    out = []
+    for _ in range(N_VALUES):
+        x = rng.uniform(1.0, 2.0) * 10.0 ** rng.randint(-30, 30)
+        mid = (decimal.Decimal(x) + decimal.Decimal(math.nextafter(x, math.inf))) / 2
+        out.append(str(ctx.create_decimal(mid)))
+    return out
+
+
+def suite_floats(rng: random.Random) -> None:
+    print("floats (by mantissa length)")
+    funcs = {"fast_float": fastnumbers.fast_float, "float": float}
+    for ndigits in (8, 12, 15, 17, 20):
+        report("{} digits".format(ndigits), float_mantissa(ndigits, rng), funcs)
+    reprs = [repr(rng.uniform(-1e6, 1e6)) for _ in range(N_VALUES)]
+    report("repr(float)", reprs, funcs)
+    report("near-halfway (40 digits)", float_near_halfway(rng), funcs)
+
+
+def suite_precision(rng: random.Random) -> None:
+    print("floats (precision='exact' vs 'fast')")
+    funcs = {
+        "exact": partial(fastnumbers.fast_float, precision="exact"),
+        "fast": partial(fastnumbers.fast_float, precision="fast"),
+    }
+    reprs = [repr(rng.uniform(-1e6, 1e6)) for _ in range(N_VALUES)]
+    report("repr(float)", reprs, funcs)
+    for ndigits in (20, 30):
+        report("{} digits".format(ndigits), float_mantissa(ndigits, rng), funcs)
+    report("near-halfway (40 digits)", float_near_halfway(rng), funcs)
+
+
+def suite_ints(rng: random.Random) -> None:
+    print("ints (by digit count)")
+    funcs = {"fast_int": fastnumbers.fast_int, "int": int}
+    for ndigits in (1, 4, 8, 12, 16, 18, 20, 30, 38, 100, 1000, 4000):
+        values = [
+            str(rng.randrange(10 ** (ndigits - 1), 10 ** ndigits))
+            for _ in range(N_VALUES)
+        ]
+        report("{} digits".format(ndigits), values, funcs)
+    values = ["{:_}".format(rng.randrange(10 ** 5, 10 ** 9)) for _ in range(N_VALUES)]
+    report("with underscores", values, funcs)
+
+
+def suite_bases(rng: random.Random) -> None:
+    print("ints with an explicit base")
+    for label, base, fmt in (
+        ("hex (16 digits)", 16, "{:x}"),
+        ("hex with 0x prefix", 16, "{:#x}"),
+        ("binary (63 digits)", 2, "{:b}"),
+        ("base 36", 36, None),
+    ):
+        values = [rng.getrandbits(63) for _ in range(N_VALUES)]
+        if fmt is None:
+            strings = [base_36(x) for x in values]
+        else:
+            strings = [fmt.format(x) for x in values]
+        funcs = {
+            "fast_int": partial(fastnumbers.fast_int, base=base),
+            "int": partial(int, base=base),
+        }
+        report(label, strings, funcs)
+
+
+def base_36(x: int) -> str:
+    digits = "0123456789abcdefghijklmnopqrstuvwxyz"
+    out = ""
+    while x:
+        x, d = divmod(x, 36)
+        out = digits[d] + out
+    return out or "0"
+
+
+def suite_predicates(rng: random.Random) -> None:
+    print("type checks (by cell contents)")
+    funcs = {
+        "isint": fastnumbers.isint,
+        "isfloat": fastnumbers.isfloat,
+        "isintlike": fastnumbers.isintlike,
+        "query_type": fastnumbers.query_type,
+    }
+    ints = [str(rng.randrange(10 ** 9, 10 ** 12)) for _ in range(N_VALUES)]
+    report("ints (10-12 digits)", ints, funcs)
+    reprs = [repr(rng.uniform(-1e6, 1e6)) for _ in range(N_VALUES)]
+    report("repr(float)", reprs, funcs)
+    report("17 digits", float_mantissa(17, rng), funcs)
+    words = ["".join(rng.choice("abcdef.") for _ in range(8)) for _ in range(N_VALUES)]
+    report("non-numbers", words, funcs)
+
+
+def suite_calls(rng: random.Random) -> None:
+    print("per-call overhead (short inputs, with and without keywords)")
+    digits = [str(rng.randrange(10)) for _ in range(N_VALUES)]
+    funcs = {
+        "fast_float": fastnumbers.fast_float,
+        "1 keyword": partial(fastnumbers.fast_float, default=None),
+        "3 keywords": partial(
+            fastnumbers.fast_float,
+            default=None,
+            allow_underscores=False,
+            on_fail=None,
+        ),
+        "Converter": fastnumbers.Converter(
+            "float", default=None, allow_underscores=False, on_fail=None
+        ),
+        "float": float,
+    }
+    report("fast_float", digits, funcs)
+    funcs = {
+        "isfloat": fastnumbers.isfloat,
+        "1 keyword": partial(fastnumbers.isfloat, allow_inf=True),
+        "3 keywords": partial(
+            fastnumbers.isfloat, str_only=False, num_only=False, allow_nan=True
+        ),
+    }
+    report("isfloat", digits, funcs)
+    funcs = {"int": fastnumbers.int, "builtin": int}
+    report("fastnumbers.int", digits, funcs)
+    funcs = {"float": fastnumbers.float, "builtin": float}
+    report("fastnumbers.float", digits, funcs)
+
+
+SUITES = {
+    "bases": suite_bases,
+    "calls": suite_calls,
+    "floats": suite_floats,
+    "ints": suite_ints,
+    "precision": suite_precision,
+    "predicates": suite_predicates,
+}
+
+
+def main(argv: Sequence[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("suites", nargs="*", help="any of " + ", ".join(SUITES))
+    args = parser.parse_args(argv)
+    unknown = set(args.suites) - set(SUITES)
+    if unknown:
+        parser.error("unknown suite(s): " + ", ".join(sorted(unknown)))
+    rng = random.Random(42)
+    for name in args.suites or sorted(SUITES):
+        SUITES[name](rng)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,183 @@
+# -*- coding: utf-8 -*-
+"""
+Generate the lookup tables used by the number parsers.
+
+Run from the project root; the output is written to src/tables.c.
+The file is checked in, so this only needs to be re-run if the
+tables themselves change, or to pick up a newer Unicode database
+(the one of the Python running this script is used).
+"""
+
+import os
+import sys
+import unicodedata
+
+SMALLEST_POWER_OF_FIVE = -342
+LARGEST_POWER_OF_FIVE = 308
+
+# Must match fastnumbers/tables.h.
+UNICODE_BLOCK_SHIFT = 7
+UNICODE_NOT_NUMERIC = 0
+UNICODE_UNASSIGNED = 1
+UNICODE_FIRST_NUMERIC = 2
+
+HEADER = """\
+/*
+ * Lookup tables for the number parsers.
+ *
+ * THIS FILE IS GENERATED BY dev/generate_tables.py - DO NOT EDIT BY HAND.
+ */
+
+#include "fastnumbers/tables.h"
+"""
+
+
+def power_of_five_128(q: int) -> int:
+    """
+    The 128 most significant bits of 5**q, truncated, for q >= 0.
+    For q < 0, a 128-bit approximation of 5**q rounded up so that
+    it never underestimates the true value.
+    """
+    if q >= 0:
+        power5 = 5 ** q
+        while power5 < (1 << 127):
+            power5 *= 2
+        while power5 >= (1 << 128):
+            power5 //= 2
+        return power5
+    power5 = 5 ** -q
+    z = power5.bit_length()
+    if 1 << (z - 1) == power5:
+        z -= 1
+    if q >= -27:
+        return 2 ** (z + 127) // power5 + 1
+    c = 2 ** (2 * z + 2 * 64) // power5 + 1
+    while c >= (1 << 128):
+        c //= 2
+    return c
+
+
+def powers_of_five_table() -> str:
+    lines = [
+        "",
+        "/* 128-bit approximations of 5**q for q in",
+        " * [FN_SMALLEST_POWER_OF_FIVE, FN_LARGEST_POWER_OF_FIVE],",
+        " * stored as (high, low) pairs of 64-bit words.",
+        " */",
+        "const uint64_t fn_power_of_five_128[] = {",
+    ]
+    for q in range(SMALLEST_POWER_OF_FIVE, LARGEST_POWER_OF_FIVE + 1):
+        c = power_of_five_128(q)
+        lines.append(
+            "    UINT64_C(0x{:016x}), UINT64_C(0x{:016x}),".format(
+                c >> 64, c & 0xFFFFFFFFFFFFFFFF
+            )
+        )
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def digit_value(c: str) -> int:
+    """The value of c as a digit in bases up to 36, or 0xFF if it is not one."""
+    if "0" <= c <= "9":
+        return ord(c) - ord("0")
+    if "a" <= c.lower() <= "z":
+        return ord(c.lower()) - ord("a") + 10
+    return 0xFF
+
+
+def digit_value_table() -> str:
+    lines = [
+        "",
+        "/* The value of each character as a digit in bases 2 to 36,",
+        " * or FN_INVALID_DIGIT if it is not a digit in any base.",
+        " */",
+        "const uint8_t fn_digit_value[256] = {",
+    ]
+    values = [digit_value(chr(i)) for i in range(256)]
+    for i in range(0, 256, 16):
+        row = ", ".join("0x{:02x}".format(v) for v in values[i : i + 16])
+        lines.append("    " + row + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def unicode_numeric_class(c: str, values: dict) -> int:
+    """
+    The class of c in the Unicode numeric table: UNICODE_NOT_NUMERIC,
+    UNICODE_UNASSIGNED, or UNICODE_FIRST_NUMERIC plus the index of
+    its entry in values (which is added if it is not there yet).
+    """
+    number = unicodedata.numeric(c, None)
+    if number is None:
+        if unicodedata.category(c) == "Cn":
+            return UNICODE_UNASSIGNED
+        return UNICODE_NOT_NUMERIC
+    is_int = unicodedata.digit(c, None) is not None
+    if is_int:
+        assert unicodedata.digit(c) == number, c
+    value = (float(number), is_int, float(number).is_integer())
+    return UNICODE_FIRST_NUMERIC + values.setdefault(value, len(values))
+
+
+def unicode_numeric_tables() -> str:
+    values: dict = {}
+    classes = [unicode_numeric_class(chr(i), values) for i in range(sys.maxunicode + 1)]
+    assert max(classes) <= 0xFF, "too many numeric values for uint8_t classes"
+
+    # Split the code points into blocks, and store each distinct block once.
+    size = 1 << UNICODE_BLOCK_SHIFT
+    blocks: dict = {}
+    block_index = []
+    for i in range(0, len(classes), size):
+        block = tuple(classes[i : i + size])
+        block_index.append(blocks.setdefault(block, len(blocks)))
+    assert len(blocks) <= 0x100, "too many blocks - change UNICODE_BLOCK_SHIFT"
+
+    lines = [
+        "",
+        "/* The numeric value of every Unicode character, as a two-level",
+        " * table made from the Unicode {} database. The block of".format(
+            unicodedata.unidata_version
+        ),
+        " * code point u is fn_unicode_numeric_block[u >> FN_UNICODE_BLOCK_SHIFT],",
+        " * and its class is the entry for u in that block of",
+        " * fn_unicode_numeric_class. Numeric classes index",
+        " * fn_unicode_numeric_value from FN_UNICODE_FIRST_NUMERIC.",
+        " */",
+        "const uint8_t fn_unicode_numeric_block[] = {",
+    ]
+    for i in range(0, len(block_index), 16):
+        row = ", ".join("{:3d}".format(v) for v in block_index[i : i + 16])
+        lines.append("    " + row + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("const uint8_t fn_unicode_numeric_class[] = {")
+    for block in blocks:
+        for i in range(0, size, 16):
+            row = ", ".join("{:3d}".format(v) for v in block[i : i + 16])
+            lines.append("    " + row + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("const UnicodeNumeric fn_unicode_numeric_value[] = {")
+    for value, is_int, is_intlike in values:
+        lines.append(
+            "    {{{!r}, {}, {}}},".format(
+                value, str(is_int).lower(), str(is_intlike).lower()
+            )
+        )
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main() -> None:
+    path = os.path.join("src", "tables.c")
+    with open(path, "w") as fl:
+        fl.write(HEADER)
+        fl.write(powers_of_five_table())
+        fl.write(digit_value_table())
+        fl.write(unicode_numeric_tables())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,221 @@
+# -*- coding: utf-8 -*-
+"""
+Scaling benchmarks for fastnumbers.
+
+Run from the project root after building in-place, e.g.
+
+    python setup.py build_ext --inplace
+    PYTHONPATH=src python dev/scaling.py [suite ...] [--max-workers N]
+
+Each suite converts the same list of strings in 1, 2, 4, ... workers
+at once and reports the total throughput in millions of values per
+second, which should grow in proportion to the number of workers (up
+to the number of cores) unless something makes them take turns.
+Threads only run in parallel on a free-threaded build of Python (and
+only if importing fastnumbers leaves the GIL disabled), except while
+Converter.map parses a block of strings, which it does without the GIL.
+"""
+
+import argparse
+import collections
+import os
+import random
+import sys
+import threading
+import time
+from typing import Any, Callable, Dict, List, Sequence, Tuple
+
+import fastnumbers
+
+N_VALUES = 20000
+N_ROUNDS = 50
+
+# Builds the inputs in a worker, as "values".
+SETUP = """
+import random
+import sys
+sys.path[:0] = {path!r}
+import fastnumbers
+rng = random.Random(42)
+values = [repr(rng.uniform(-1e6, 1e6)) for _ in range({n_values} // 2)]
+values += [str(rng.randrange(10 ** 12)) for _ in range({n_values} // 2)]
+"""
+
+# Times converting the inputs in a worker, writing the start and end
+# to the file descriptor fd (time.perf_counter is the same clock in
+# every interpreter of a process).
+RUN = """
+import collections
+import os
+import time
+convert = fastnumbers.fast_real
+start = time.perf_counter()
+for _ in range({n_rounds}):
+    collections.deque(map(convert, values), maxlen=0)
+os.write({fd}, "{{}} {{}}\\n".format(start, time.perf_counter()).encode())
+"""
+
+
+def interpreters_api() -> Tuple[Any, Tuple[Any, ...], Dict[str, Any]]:
+    """Return the (private) module for subinterpreters, and the arguments
+    that create one with its own GIL."""
+    try:
+        import _interpreters  # Python 3.13 on
+
+        return _interpreters, ("isolated",), {}
+    except ImportError:
+        pass
+    if sys.version_info < (3, 12):
+        raise SystemExit("interpreters with their own GIL need Python 3.12+")
+    import _xxsubinterpreters
+
+    return _xxsubinterpreters, (), {"isolated": True}
+
+
+def run_string(api: Any, interp: Any, code: str) -> None:
+    """Run code in interp, raising if it fails (which _interpreters
+    reports by returning the error)."""
+    error = api.run_string(interp, code)
+    if error is not None:
+        raise RuntimeError(error.formatted)
+
+
+def read_spans(fd: int, n: int) -> List[Tuple[float, float]]:
+    lines = b""
+    while lines.count(b"\n") < n:
+        lines += os.read(fd, 4096)
+    return [
+        (float(start), float(end))
+        for start, end in (line.split() for line in lines.decode().splitlines())
+    ]
+
+
+def report(n_workers: int, spans: List[Tuple[float, float]], base: float) -> float:
+    """Print the total throughput of workers that ran over spans, and
+    return it."""
+    wall = max(end for _, end in spans) - min(start for start, _ in spans)
+    rate = n_workers * N_ROUNDS * N_VALUES / wall / 1e6
+    speedup = rate / base if base else 1.0
+    print(
+        "  {:3d} workers  {:8.2f} Mvalues/s  {:5.2f}x  ({:3.0f}% of linear)".format(
+            n_workers, rate, speedup, 100 * speedup / n_workers
+        )
+    )
+    return rate
+
+
+def suite_interpreters(counts: Sequence[int]) -> None:
+    print("subinterpreters, each with its own GIL (fast_real)")
+    api, args, kwargs = interpreters_api()
+    setup = SETUP.format(path=sys.path, n_values=N_VALUES)
+    base = 0.0
+    for n in counts:
+        interps = [api.create(*args, **kwargs) for _ in range(n)]
+        for interp in interps:
+            run_string(api, interp, setup)
+        read_fd, write_fd = os.pipe()
+        code = RUN.format(n_rounds=N_ROUNDS, fd=write_fd)
+        threads = [
+            threading.Thread(target=run_string, args=(api, interp, code))
+            for interp in interps
+        ]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        rate = report(n, read_spans(read_fd, n), base)
+        base = base or rate
+        os.close(read_fd)
+        os.close(write_fd)
+        for interp in interps:
+            api.destroy(interp)
+
+
+def suite_threads(counts: Sequence[int]) -> None:
+    gil = getattr(sys, "_is_gil_enabled", lambda: True)()
+    print(
+        "threads over shared lists (fast_float and fast_int), GIL {}".format(
+            "enabled" if gil else "disabled"
+        )
+    )
+    rng = random.Random(42)
+    floats = [repr(rng.uniform(-1e6, 1e6)) for _ in range(N_VALUES // 2)]
+    ints = [str(rng.randrange(10 ** 12)) for _ in range(N_VALUES // 2)]
+    base = 0.0
+    for n in counts:
+        barrier = threading.Barrier(n)
+        spans: List[Tuple[float, float]] = []
+
+        def work() -> None:
+            barrier.wait()
+            start = time.perf_counter()
+            for _ in range(N_ROUNDS):
+                collections.deque(map(fastnumbers.fast_float, floats), maxlen=0)
+                collections.deque(map(fastnumbers.fast_int, ints), maxlen=0)
+            spans.append((start, time.perf_counter()))
+
+        threads = [threading.Thread(target=work) for _ in range(n)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        rate = report(n, spans, base)
+        base = base or rate
+
+
+def suite_batches(counts: Sequence[int]) -> None:
+    print("threads over shared lists (Converter('real').map)")
+    rng = random.Random(42)
+    values = [repr(rng.uniform(-1e6, 1e6)) for _ in range(N_VALUES // 2)]
+    values += [str(rng.randrange(10 ** 12)) for _ in range(N_VALUES // 2)]
+    convert = fastnumbers.Converter("real")
+    base = 0.0
+    for n in counts:
+        barrier = threading.Barrier(n)
+        spans: List[Tuple[float, float]] = []
+
+        def work() -> None:
+            barrier.wait()
+            start = time.perf_counter()
+            for _ in range(N_ROUNDS):
+                convert.map(values)
+            spans.append((start, time.perf_counter()))
+
+        threads = [threading.Thread(target=work) for _ in range(n)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        rate = report(n, spans, base)
+        base = base or rate
+
+
+SUITES: Dict[str, Callable[[Sequence[int]], None]] = {
+    "batches": suite_batches,
+    "interpreters": suite_interpreters,
+    "threads": suite_threads,
+}
+
+
+def main(argv: Sequence[str]) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("suites", nargs="*", help="any of " + ", ".join(SUITES))
+    parser.add_argument(
+        "--max-workers",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="the most workers to run at once (default: the number of CPUs)",
+    )
+    args = parser.parse_args(argv)
+    unknown = set(args.suites) - set(SUITES)
+    if unknown:
+        parser.error("unknown suite(s): " + ", ".join(sorted(unknown)))
+    counts = [1]
+    while counts[-1] * 2 <= args.max_workers:
+        counts.append(counts[-1] * 2)
+    for name in args.suites or sorted(SUITES):
+        SUITES[name](counts)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
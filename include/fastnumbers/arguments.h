@@ -0,0 +1,78 @@
+#ifndef __FN_ARGUMENTS
+#define __FN_ARGUMENTS
+
+/*
+ * Argument parsing for functions called with the "fastcall" convention,
+ * where the arguments come as an array (with the names of those given
+ * by keyword in a tuple) instead of a tuple and a dict that must be
+ * built for every call.
+ */
+
+#include <Python.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The method flags for a fastcall function that takes keywords. Python
+ * 3.6 passes keywords to any METH_FASTCALL function, and from 3.7 on
+ * only to those that are also METH_KEYWORDS.
+ */
+#if PY_VERSION_HEX >= 0x03070000
+#define FN_METH_FASTCALL (METH_FASTCALL | METH_KEYWORDS)
+#else
+#define FN_METH_FASTCALL METH_FASTCALL
+#endif
+
+/* The most parameters a function can have. */
+#define FN_MAX_PARAMETERS 16
+
+/* How the argument for a parameter is stored. */
+typedef enum FnArgumentKind {
+    FN_ARG_OBJECT,  /* As a borrowed PyObject *. */
+    FN_ARG_BOOL,    /* As an int, from the truth of the object. */
+} FnArgumentKind;
+
+/* A parameter of a function. Its name is "" if it can only be given
+ * by position.
+ */
+typedef struct FnParameter {
+    const char *name;
+    FnArgumentKind kind;
+} FnParameter;
+
+/* The parameters of a function. The first npositional can be given by
+ * position, and the first nrequired must be given. Keywords are matched
+ * to the names by their characters, so a signature holds no Python
+ * objects and can be shared by every interpreter and thread.
+ */
+typedef struct FnSignature {
+    const char *fname;
+    const FnParameter *parameters;
+    Py_ssize_t nparameters;
+    Py_ssize_t npositional;
+    Py_ssize_t nrequired;
+} FnSignature;
+
+#define FN_SIGNATURE(fname, parameters, nrequired, npositional) {   \
+        (fname), (parameters),                                      \
+        sizeof(parameters) / sizeof((parameters)[0]),               \
+        (npositional), (nrequired)                                  \
+    }
+
+/* Declarations */
+
+/* Parse the arguments of a fastcall function. After kwnames comes a
+ * pointer for each parameter, in order, of the type given by its kind,
+ * which is only assigned to if the argument was given. Returns -1 with
+ * a TypeError set (like PyArg_ParseTupleAndKeywords would) on failure.
+ */
+int
+fn_parse_arguments(const FnSignature *signature, PyObject *const *args,
+                   const Py_ssize_t nargs, PyObject *kwnames, ...);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_ARGUMENTS */
@@ -0,0 +1,29 @@
+#ifndef __FN_CONVERTER
+#define __FN_CONVERTER
+
+/*
+ * A callable that converts its input with options given once, when it
+ * is created. The options are checked and stored as an Options struct
+ * then, so each call only has to take the one argument.
+ */
+
+#include <Python.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Declarations */
+
+/* Create the Converter type for the given module, whose converters
+ * raise the InvalidNumberError in its state. Returns NULL with an
+ * exception set on failure.
+ */
+PyObject *
+converter_new_type(PyObject *module);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_CONVERTER */
@@ -17,7 +17,7 @@ PyDoc_STRVAR(fastnumbers__doc__, "Quickly convert strings to numbers.\n");
 
 
 PyDoc_STRVAR(fast_real__doc__,
-"fast_real(x, default=None, raise_on_invalid=False, on_fail=None, nan=None, inf=None, coerce=True, allow_underscores=True)\n"
+"fast_real(x, default=None, raise_on_invalid=False, on_fail=None, nan=None, inf=None, coerce=True, allow_underscores=True, precision='exact', trusted=False)\n"
 "Quickly convert input to an `int` or `float` depending on value.\n"
 "\n"
 "Any input that is valid for the built-in `float` or `int` functions will\n"
@@ -62,6 +62,20 @@ PyDoc_STRVAR(fast_real__doc__,
 "    and in strings passed to `int` or `float` (see PEP 515 for details on\n"
 "    what is and is not allowed). You can disable that behavior by setting\n"
 "    this option to *False* - the default is *True*.\n"
+"precision : {'exact', 'fast'}, optional\n"
+"    With *'exact'* (the default), floats in strings are correctly\n"
+"    rounded, exactly as by `float`. With *'fast'*, only the first 19\n"
+"    significant digits are used, so a float with more digits may be\n"
+"    off by up to one unit in the last place (the result is always one\n"
+"    of the two doubles either side of the true value). This skips the\n"
+"    slow path needed to round such floats exactly.\n"
+"trusted : bool, optional\n"
+"    If *True*, string input is trusted to be a number in canonical\n"
+"    form - an optional sign and digits, then an optional fraction and\n"
+"    exponent, with no whitespace, underscores, infinity or NaN. The\n"
+"    checks for those are skipped.\n"
+"    What other input is converted to is unspecified (but it is\n"
+"    always read safely). The default is *False*.\n"
 "\n"
 "Returns\n"
 "-------\n"
@@ -77,9 +91,9 @@ PyDoc_STRVAR(fast_real__doc__,
 "------\n"
 "TypeError\n"
 "    If the input is not one of `str`, `float`, or `int`.\n"
-"ValueError\n"
-"    If `raise_on_invalid` is *True*, this will be raised if the input\n"
-"    string cannot be converted to a `float` or `int`.\n"
+"InvalidNumberError\n"
+"    If `raise_on_invalid` is *True*, this subclass of `ValueError` will\n"
+"    be raised if the input string cannot be converted to a `float` or `int`.\n"
 "\n"
 "See Also\n"
 "--------\n"
@@ -121,7 +135,7 @@ PyDoc_STRVAR(fast_real__doc__,
 "    >>> fast_real('56.07 lb', raise_on_invalid=True) #doctest: +IGNORE_EXCEPTION_DETAIL\n"
 "    Traceback (most recent call last):\n"
 "      ...\n"
-"    ValueError: could not convert string to float: '56.07 lb'\n"
+"    InvalidNumberError: could not convert string to float: '56.07 lb'\n"
 "    >>> fast_real('invalid', on_fail=len)\n"
 "    7\n"
 "\n"
@@ -155,7 +169,7 @@ PyDoc_STRVAR(fast_real__doc__,
 
 
 PyDoc_STRVAR(fast_float__doc__,
-"fast_float(x, default=None, raise_on_invalid=False, on_fail=None, nan=None, inf=None, allow_underscores=True)\n"
+"fast_float(x, default=None, raise_on_invalid=False, on_fail=None, nan=None, inf=None, allow_underscores=True, precision='exact', trusted=False)\n"
 "Quickly convert input to a `float`.\n"
 "\n"
 "Any input that is valid for the built-in `float` function will\n"
@@ -196,6 +210,20 @@ PyDoc_STRVAR(fast_float__doc__,
 "    and in strings passed to `int` or `float` (see PEP 515 for details on\n"
 "    what is and is not allowed). You can disable that behavior by setting\n"
 "    this option to *False* - the default is *True*.\n"
+"precision : {'exact', 'fast'}, optional\n"
+"    With *'exact'* (the default), floats in strings are correctly\n"
+"    rounded, exactly as by `float`. With *'fast'*, only the first 19\n"
+"    significant digits are used, so a float with more digits may be\n"
+"    off by up to one unit in the last place (the result is always one\n"
+"    of the two doubles either side of the true value). This skips the\n"
+"    slow path needed to round such floats exactly.\n"
+"trusted : bool, optional\n"
+"    If *True*, string input is trusted to be a number in canonical\n"
+"    form - an optional sign and digits, then an optional fraction and\n"
+"    exponent, with no whitespace, underscores, infinity or NaN. The\n"
+"    checks for those are skipped.\n"
+"    What other input is converted to is unspecified (but it is\n"
+"    always read safely). The default is *False*.\n"
 "\n"
 "Returns\n"
 "-------\n"
@@ -209,9 +237,9 @@ PyDoc_STRVAR(fast_float__doc__,
 "------\n"
 "TypeError\n"
 "    If the input is not one of `str`, `float`, or `int`.\n"
-"ValueError\n"
-"    If `raise_on_invalid` is *True*, this will be raised if the input\n"
-"    string cannot be converted to a `float`.\n"
+"InvalidNumberError\n"
+"    If `raise_on_invalid` is *True*, this subclass of `ValueError` will\n"
+"    be raised if the input string cannot be converted to a `float`.\n"
 "\n"
 "See Also\n"
 "--------\n"
@@ -247,7 +275,7 @@ PyDoc_STRVAR(fast_float__doc__,
 "    >>> fast_float('56.07 lb', raise_on_invalid=True) #doctest: +IGNORE_EXCEPTION_DETAIL\n"
 "    Traceback (most recent call last):\n"
 "      ...\n"
-"    ValueError: could not convert string to float: '56.07 lb'\n"
+"    InvalidNumberError: could not convert string to float: '56.07 lb'\n"
 "    >>> fast_float('invalid', on_fail=len)\n"
 "    7\n"
 "\n"
@@ -280,7 +308,7 @@ PyDoc_STRVAR(fast_float__doc__,
 
 
 PyDoc_STRVAR(fast_int__doc__,
-"fast_int(x, default=None, raise_on_invalid=False, on_fail=None, base=10, allow_underscores=True)\n"
+"fast_int(x, default=None, raise_on_invalid=False, on_fail=None, base=10, allow_underscores=True, trusted=False)\n"
 "Quickly convert input to an `int`.\n"
 "\n"
 "Any input that is valid for the built-in `int`\n"
@@ -319,6 +347,13 @@ PyDoc_STRVAR(fast_int__doc__,
 "    and in strings passed to `int` or `float` (see PEP 515 for details on\n"
 "    what is and is not allowed). You can disable that behavior by setting\n"
 "    this option to *False* - the default is *True*.\n"
+"trusted : bool, optional\n"
+"    If *True*, string input is trusted to be an int in canonical\n"
+"    form - an optional sign and digits, with no whitespace or\n"
+"    underscores. The checks for those are skipped (unless *base* is\n"
+"    given, which is not affected).\n"
+"    What other input is converted to is unspecified (but it is\n"
+"    always read safely). The default is *False*.\n"
 "\n"
 "Returns\n"
 "-------\n"
@@ -333,9 +368,9 @@ PyDoc_STRVAR(fast_int__doc__,
 "------\n"
 "TypeError\n"
 "    If the input is not one of `str`, `float`, or `int`.\n"
-"ValueError\n"
-"    If `raise_on_invalid` is *True*, this will be raised if the input\n"
-"    string cannot be converted to an `int`.\n"
+"InvalidNumberError\n"
+"    If `raise_on_invalid` is *True*, this subclass of `ValueError` will\n"
+"    be raised if the input string cannot be converted to an `int`.\n"
 "\n"
 "See Also\n"
 "--------\n"
@@ -364,7 +399,7 @@ PyDoc_STRVAR(fast_int__doc__,
 "    >>> fast_int('56.07 lb', raise_on_invalid=True) #doctest: +IGNORE_EXCEPTION_DETAIL\n"
 "    Traceback (most recent call last):\n"
 "      ...\n"
-"    ValueError: could not convert string to int: '56.07 lb'\n"
+"    InvalidNumberError: invalid literal for int() with base 10: '56.07 lb'\n"
 "    >>> fast_int('invalid', on_fail=len)\n"
 "    7\n"
 "\n"
@@ -389,7 +424,7 @@ PyDoc_STRVAR(fast_int__doc__,
 
 
 PyDoc_STRVAR(fast_forceint__doc__,
-"fast_forceint(x, default=None, raise_on_invalid=False, on_fail=None, allow_underscores=True)\n"
+"fast_forceint(x, default=None, raise_on_invalid=False, on_fail=None, allow_underscores=True, trusted=False)\n"
 "Quickly convert input to an `int`, truncating if is a `float`.\n"
 "\n"
 "Any input that is valid for the built-in `int`\n"
@@ -428,6 +463,13 @@ PyDoc_STRVAR(fast_forceint__doc__,
 "    and in strings passed to `int` or `float` (see PEP 515 for details on\n"
 "    what is and is not allowed). You can disable that behavior by setting\n"
 "    this option to *False* - the default is *True*.\n"
+"trusted : bool, optional\n"
+"    If *True*, string input is trusted to be a number in canonical\n"
+"    form - an optional sign and digits, then an optional fraction and\n"
+"    exponent, with no whitespace, underscores, infinity or NaN. The\n"
+"    checks for those are skipped.\n"
+"    What other input is converted to is unspecified (but it is\n"
+"    always read safely). The default is *False*.\n"
 "\n"
 "Returns\n"
 "-------\n"
@@ -442,9 +484,9 @@ PyDoc_STRVAR(fast_forceint__doc__,
 "------\n"
 "TypeError\n"
 "    If the input is not one of `str`, `float`, or `int`.\n"
-"ValueError\n"
-"    If `raise_on_invalid` is *True*, this will be raised if the input\n"
-"    string cannot be converted to an `int`.\n"
+"InvalidNumberError\n"
+"    If `raise_on_invalid` is *True*, this subclass of `ValueError` will\n"
+"    be raised if the input string cannot be converted to an `int`.\n"
 "\n"
 "See Also\n"
 "--------\n"
@@ -474,7 +516,7 @@ PyDoc_STRVAR(fast_forceint__doc__,
 "    >>> fast_forceint('56.07 lb', raise_on_invalid=True) #doctest: +IGNORE_EXCEPTION_DETAIL\n"
 "    Traceback (most recent call last):\n"
 "      ...\n"
-"    ValueError: could not convert string to float: '56.07 lb'\n"
+"    InvalidNumberError: could not convert string to float: '56.07 lb'\n"
 "    >>> fast_forceint('invalid', on_fail=len)\n"
 "    7\n"
 "\n"
@@ -990,6 +1032,18 @@ PyDoc_STRVAR(fastnumbers_real__doc__,
 "*float*.\n"
 "\n");
 
+
+PyDoc_STRVAR(scratch_allocations__doc__,
+"scratch_allocations()\n"
+"Count the heap allocations made for scratch space on this thread.\n"
+"\n"
+"Copies of strings that cannot be parsed in place (e.g. long unicode\n"
+"strings, or strings with non-ASCII digits) are made in scratch space\n"
+"that is kept between calls, so this count should stop growing once a\n"
+"thread has seen the longest string it will parse. This is intended\n"
+"for debugging.\n"
+"\n");
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,40 @@
+#ifndef __FN_EXCEPTIONS
+#define __FN_EXCEPTIONS
+
+/*
+ * The exception raised for input that is not a valid number. It is a
+ * ValueError that keeps the input, and only formats its message (the
+ * same one Python would give) once something asks for it - most are
+ * caught and discarded without that ever happening.
+ */
+
+#include <Python.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The base given for an input that is not a valid float. */
+#define FN_FLOAT_BASE (-1)
+
+/* Declarations */
+
+/* Create the InvalidNumberError type, which derives from ValueError,
+ * for the given module (each has a type of its own). Returns NULL with
+ * an exception set on failure.
+ */
+PyObject *
+invalid_number_error_new_type(PyObject *module);
+
+/* Raise an InvalidNumberError (of the given type) for input, which is
+ * not a valid int in the given base, or not a valid float if that is
+ * FN_FLOAT_BASE.
+ */
+void
+set_invalid_number_error(PyObject *type, PyObject *input, const int base);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_EXCEPTIONS */
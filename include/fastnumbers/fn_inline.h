@@ -0,0 +1,19 @@
+#ifndef __FN_INLINE
+#define __FN_INLINE
+
+#include <Python.h>
+
+/* Declare a static function that is always inlined, for small helpers
+ * called from few places whose call overhead matters, or for function
+ * templates that are meant to be compiled once per set of constant
+ * arguments.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define FN_INLINE(type) static inline __attribute__((always_inline)) type
+#elif defined(_MSC_VER)
+#define FN_INLINE(type) static __forceinline type
+#else
+#define FN_INLINE(type) Py_LOCAL_INLINE(type)
+#endif
+
+#endif /* __FN_INLINE */
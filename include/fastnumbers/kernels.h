@@ -0,0 +1,81 @@
+#ifndef __FN_KERNELS
+#define __FN_KERNELS
+
+/*
+ * Vectorized classification of short strings for tokenize_number,
+ * and narrowing of unicode strings to ASCII, with a variant for each
+ * instruction set chosen at import time.
+ */
+
+#include <Python.h>
+#include "fastnumbers/pstdint.h"
+#include "fastnumbers/fn_bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Vector variants are only built for x86 with a compiler that can
+ * target instruction sets per function (so the extension itself needs
+ * no special flags). Elsewhere only the scalar variant exists.
+ */
+#if (defined(__x86_64__) || defined(__i386__) || \
+     defined(_M_X64) || defined(_M_IX86)) && \
+    (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define FN_HAVE_VECTOR_KERNELS 1
+#else
+#define FN_HAVE_VECTOR_KERNELS 0
+#endif
+
+/* The longest string that is classified in one go. */
+#define FN_MAX_CLASSIFY_LEN 32
+
+/* Returned when a string could not be classified (it is too long,
+ * or this is the scalar variant), meaning the scalar parser must decide.
+ */
+#define FN_UNCLASSIFIED -1
+
+/* Name of the environment variable that forces a variant. */
+#define FN_KERNELS_ENV "FASTNUMBERS_KERNELS"
+
+/* One variant of the kernels. classify_int gives the same answer
+ * as string_contains_int in base 10, and classify_number gives the
+ * same kind as tokenize_number (once the sign has been consumed and
+ * infinity and NaN have been ruled out) as a NumberKind, reporting
+ * int-like floats as FN_FLOAT unless intlike is true. Either gives
+ * FN_UNCLASSIFIED if the string cannot be classified.
+ * narrow_ucs2 copies len code units to dst as ASCII characters,
+ * returning false (leaving dst undefined) if any code unit is not
+ * ASCII. (There is no UCS4 equivalent - such strings always contain
+ * a character outside the BMP, which cannot be whitespace, so they
+ * can never be narrowed.)
+ */
+typedef struct Kernels {
+    const char *name;
+    int (*classify_int)(const char *str, const char *end);
+    int (*classify_number)(const char *str, const char *end,
+                           const bool intlike);
+    bool (*narrow_ucs2)(const Py_UCS2 *src, const Py_ssize_t len, char *dst);
+} Kernels;
+
+/* The variant in use. This is NULL until select_kernels is first
+ * called, which sets it once for the whole process; from then on it is
+ * read by every thread (and interpreter) without a lock.
+ */
+extern const Kernels *kernels;
+
+/* Declarations */
+
+/* Choose the best variant this CPU supports, or the one named by
+ * the FN_KERNELS_ENV environment variable, unless one has already been
+ * chosen. Returns -1 and sets a Python exception if the variable names
+ * an unknown or unsupported variant, or 0 on success.
+ */
+int
+select_kernels(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_KERNELS */
@@ -7,6 +7,7 @@
 
 #include <Python.h>
 #include <limits.h>
+#include "fastnumbers/exceptions.h"
 #include "fastnumbers/fn_bool.h"
 #include "fastnumbers/options.h"
 
@@ -26,27 +27,23 @@ compat_generate_nan(int sign);
 #define PyNumber_IsNAN(pynum) (PyFloat_Check(pynum) && Py_IS_NAN(PyFloat_AS_DOUBLE(pynum)))
 #define PyNumber_IsINF(pynum) (PyFloat_Check(pynum) && Py_IS_INFINITY(PyFloat_AS_DOUBLE(pynum)))
 
-/* Return NaN correctly on this system. */
+/* Generate NaN correctly on this system. */
 #if !defined(PY_NO_SHORT_FLOAT_REPR)
-#define PyFloat_from_NaN(negative) PyFloat_FromDouble(compat_generate_nan(negative));
+#define signed_NaN(negative) compat_generate_nan(negative)
 #else
-#define PyFloat_from_NaN(negative) \
-    (negative) ? PyFloat_FromDouble(-Py_NAN) : PyFloat_FromDouble(Py_NAN);
+#define signed_NaN(negative) ((negative) ? -Py_NAN : Py_NAN)
 #endif
 
-/* Quickies for raising errors. Try to mimic what Python would say. */
-#define FN_FLOAT_MSG "could not convert string to float: %R"
-#define FN_INT_MSG "invalid literal for int() with base %d: %R"
-
-#define SET_ERR_INVALID_INT(o)                              \
-    if (Options_Should_Raise(o))                            \
-        PyErr_Format(PyExc_ValueError,                      \
-                     FN_INT_MSG,                            \
-                     (o)->base == INT_MIN ? 10 : (o)->base, \
-                     (o)->input)
+/* Quickies for raising errors. Try to mimic what Python would say
+ * (the message is only formatted when read, see exceptions.h).
+ */
+#define SET_ERR_INVALID_INT(o)                                    \
+    if (Options_Should_Raise(o))                                  \
+        set_invalid_number_error((o)->error_type, (o)->input,     \
+                                 (o)->base == INT_MIN ? 10 : (o)->base)
 #define SET_ERR_INVALID_FLOAT(o) \
     if (Options_Should_Raise(o)) \
-        PyErr_Format(PyExc_ValueError, FN_FLOAT_MSG, (o)->input)
+        set_invalid_number_error((o)->error_type, (o)->input, FN_FLOAT_BASE)
 #define SET_ILLEGAL_BASE_ERROR(o)        \
     if (Options_Should_Raise(o))         \
         PyErr_SetString(PyExc_TypeError, \
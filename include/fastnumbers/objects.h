@@ -25,6 +25,16 @@ PyObject_is_number(PyObject *obj, const PyNumberType type,
 PyObject *
 PyObject_contains_type(PyObject *obj, const Options *options);
 
+/* Convert each item of a tuple into a new list, parsing strings in
+ * batches without the GIL. options are as for PyObject_to_PyNumber
+ * but for those set by Options_Set_Return_Value, which are set for
+ * each item from default_value and raise.
+ */
+PyObject *
+PyTuple_to_PyNumbers(PyObject *items, const PyNumberType type,
+                     const Options *options, PyObject *default_value,
+                     const bool raise);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
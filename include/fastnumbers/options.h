@@ -21,11 +21,14 @@ typedef struct Options {
     PyObject *on_fail;
     PyObject *handle_inf;
     PyObject *handle_nan;
+    PyObject *error_type;   /* InvalidNumberError of the module. */
     int coerce;             /* use int instead of bool because   */
     int num_only;           /* PyArg_ParseTupleAndKeywords       */
     int str_only;           /* does not support 'bool' type with */
     int allow_underscores;  /* the "p" converter.                */
+    int trusted;            /* Input is known to be well-formed. */
     bool allow_uni;
+    bool exact;             /* Correctly round floats? */
     int base;
 } Options;
 
@@ -37,11 +40,14 @@ typedef struct Options {
         .on_fail = NULL,           \
         .handle_inf = NULL,        \
         .handle_nan = NULL,        \
+        .error_type = NULL,        \
         .coerce = true,            \
         .num_only = false,         \
         .str_only = false,         \
         .allow_underscores = true, \
+        .trusted = false,          \
         .allow_uni = true,         \
+        .exact = true,             \
         .base = INT_MIN,           \
     }
 #define init_Options_check {       \
@@ -50,11 +56,14 @@ typedef struct Options {
         .on_fail = NULL,           \
         .handle_inf = Py_False,    \
         .handle_nan = Py_False,    \
+        .error_type = NULL,        \
         .coerce = true,            \
         .num_only = false,         \
         .str_only = false,         \
         .allow_underscores = true, \
+        .trusted = false,          \
         .allow_uni = true,         \
+        .exact = true,             \
         .base = INT_MIN,           \
     }
 
@@ -70,9 +79,24 @@ typedef struct Options {
 #define Options_Allow_Infinity(o) PyObject_IsTrue((o)->handle_inf)
 #define Options_Allow_NAN(o) PyObject_IsTrue((o)->handle_nan)
 #define Options_Allow_Underscores(o) ((o)->allow_underscores)
+#define Options_Exact_Floats(o) ((o)->exact)
+#define Options_Trusted(o) ((o)->trusted)
 #define Options_String_Only(o) ((o)->str_only)
 #define Options_Number_Only(o) ((o)->num_only)
 
+/* Are the options that affect a successful conversion of a string
+ * all as in init_Options_convert? The others only affect what
+ * happens on error, or to input that is not a string.
+ */
+#define Options_Default_Conversion(o)   \
+    ((o)->handle_inf == NULL &&         \
+     (o)->handle_nan == NULL &&         \
+     (o)->coerce &&                     \
+     (o)->allow_underscores &&          \
+     !(o)->trusted &&                   \
+     (o)->exact &&                      \
+     (o)->base == INT_MIN)
+
 /* Set allow unicode. */
 #define Options_Set_Disallow_UnicodeCharacter(o) \
     do {                        \
@@ -100,6 +124,20 @@ typedef struct Options {
                  ? NULL \
                  : (((o).on_fail != NULL || default_value == NULL) ? input : default_value)
 
+/* Declarations */
+
+/* Read the base for ints (INT_MIN if pybase is NULL) into base.
+ * Returns 1 with an exception set if it is not valid, else 0.
+ */
+int
+assess_integer_base_input(PyObject *pybase, int *base);
+
+/* Read the precision for floats (exact if pyprecision is NULL) into
+ * exact. Returns 1 with an exception set if it is not valid, else 0.
+ */
+int
+assess_precision_input(PyObject *pyprecision, bool *exact);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -24,83 +24,99 @@ extern "C" {
 #define ascii2long(c) ((long) (*(c) - '0'))
 #define ascii2ulong(c) ((unsigned long) (*(c) - '0'))
 
-/* ID characters. */
+/* ID characters. These look at the character at c, so must not be
+ * given the end of a string.
+ */
 #define is_white_space(c) (*(c) == ' ' || (*(c) >= '\t' && *(c) <= '\r'))
 #define is_valid_digit(c) (*(c) >= '0' && *(c) <= '9')
 #define is_valid_digit_char(c) ((c) >= '0' && (c) <= '9')
 #define is_sign(c) (*(c) == '-' || *(c) == '+')
 
-/* Consume characters based on ID. */
-#define consume_white_space(str) while (is_white_space(str)) ++(str)
-#define consume_sign(str) if (is_sign(str)) str += 1
-#define consume_and_return_sign(str) \
-    (*(str) == '-' ? ((str)++, -1) : ((*(str) == '+') ? ((str)++, 1) : 1))
+/* Consume characters based on ID, never going past end. */
+#define consume_white_space(str, end) \
+    while ((str) != (end) && is_white_space(str)) ++(str)
+#define consume_sign(str, end) if ((str) != (end) && is_sign(str)) str += 1
+#define consume_and_return_sign(str, end) \
+    ((str) == (end) ? 1 : \
+     *(str) == '-' ? ((str)++, -1) : ((*(str) == '+') ? ((str)++, 1) : 1))
 
 /* A rather bold macro to strip whitespace from both ends. */
 #define strip_whitespace(start, end, length) \
     do { \
-        (end) = (start) + (size_t) (length) - 1; /* Length includes NUL char. */ \
-        consume_white_space(start); \
-        while (is_white_space(end) && (start) != (end)) --(end); \
-        end += 1;  /* End on the space after the non-whitespace. */ \
+        (end) = (start) + (size_t) (length); \
+        consume_white_space(start, end); \
+        while ((end) != (start) && is_white_space((end) - 1)) --(end); \
     } while(0)
 
 
 /* Overflow detection */
 
-/* Define the number of digits in an int that fastnumbers is willing
- * to attempt to convert itself. This is entirely based on the size
- * of a this compilers long, since the long is what Python uses to
- * represent an int under the hood - use one less than the maximum
- * length of a long.
+/* Define the number of significant digits in an int that fastnumbers
+ * is willing to attempt to convert itself. Digits are accumulated 19 at
+ * a time into 64-bit words, which are combined in a 128-bit integer if
+ * the compiler has one - 38 digits are always below 2**127, so such an
+ * int can never overflow. Otherwise only the first word and a single
+ * digit more are accepted, and that 20th digit is checked against
+ * UINT64_MAX. Longer ints are handed to Python's parser.
+ */
+#define FN_WORD_DIGITS 19
+#define FN_WORD_SCALE UINT64_C(10000000000000000000)
+
+/* Define how many digits parse_int_to_limbs may be given at once -
+ * its cost is quadratic in the length. Longer ints are split into
+ * such blocks and combined with Python's (subquadratic) arithmetic.
  */
-#if ULONG_MAX == UINT64_MAX
-/* 64-bit int max == 9223372036854775807; len('9223372036854775807') - 1 == 18 */
-#define FN_MAX_INT_LEN 18
+#define FN_MAX_LIMBS_LEN (FN_WORD_DIGITS * 1024)
+#if defined(__SIZEOF_INT128__)
+#define FN_HAVE_INT128 1
+#define FN_MAX_INT_LEN 38
+typedef unsigned __int128 fn_uint_t;
 #else
-/* 32-bit int max == 2147483647; len('2147483647') - 1 == 9 */
-#define FN_MAX_INT_LEN 9
+#define FN_HAVE_INT128 0
+#define FN_MAX_INT_LEN 20
+typedef uint64_t fn_uint_t;
 #endif
 
-/* Define the number of digits in a float that fastnumbers is willing
- * to attempt to convert itself. For Clang and GNUC, it is known
- * that DBL_DIG - 4 works. It is known that DBL_DIG - 6 works for MSVC.
- * To be safe, any compiler not known during fastnumbers testing will
- * use DBL_DIG - 6.
- * Also define the largest and smallest exponent that
- * fastnumbers is willing attempt to convert itself. For Clang and GNUC,
- * it is known that larger numbers work than MSVC.
- * To be safe, any compiler not known during fastnumbers testing will
- * use the smaller numbers.
+/* Define the range in which a float is converted with plain double
+ * arithmetic (Clinger's fast path) - a mantissa that fits in the 53 bits
+ * of a double scaled by an exactly representable power of ten is
+ * correctly rounded by a single IEEE multiply or divide. This only
+ * holds if the compiler evaluates double expressions in double
+ * precision, which is not the case with x87 extended precision.
+ * Anything outside this range is converted with the Eisel-Lemire
+ * algorithm instead.
+ *
+ * setup.py measures the range on the platform being built for (see
+ * src/probe/float_limits.c), which also finds the exponents for which
+ * extended precision is still exact. Without that, it is guessed from
+ * the compiler.
  */
-#if defined(__clang__) || defined(__GNUC__)
-
-#define FN_DBL_DIG DBL_DIG - 4
-#define FN_MAX_EXP 99
-#define FN_MIN_EXP -98
-#define neg_exp_ok(len, str) \
-    ((len) == 1) || \
-    ((len) == 2 && (*(str) <= '8' || \
-                    (*(str) == '9' && *((str) + 1) <= '8')))
-#define pos_exp_ok(len, str) (len) > 0 && (len) <= 2
-
+#define FN_DBL_DIG DBL_DIG
+#define FN_MAX_EXACT_MANTISSA (UINT64_C(1) << 53)
+#if defined(FN_PROBED_MAX_EXP) && defined(FN_PROBED_MIN_EXP)
+#define FN_MAX_EXP FN_PROBED_MAX_EXP
+#define FN_MIN_EXP FN_PROBED_MIN_EXP
+#define FN_EXACT_DOUBLE_ARITHMETIC 1
 #else
-
-#define FN_DBL_DIG DBL_DIG - 6
 #define FN_MAX_EXP 22
-#define pos_exp_ok(len, str) \
-    ((len) == 1) || \
-    ((len) == 2 && (*(str) <= '1' || \
-                    (*(str) == '2' && *((str) + 1) <= '2')))
 #define FN_MIN_EXP -22
-#define neg_exp_ok(len, str) \
-    ((len) == 1) || \
-    ((len) == 2 && (*(str) <= '1' || \
-                    (*(str) == '2' && *((str) + 1) <= '2')))
-
+#if (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0) || defined(_MSC_VER)
+#define FN_EXACT_DOUBLE_ARITHMETIC 1
+#else
+#define FN_EXACT_DOUBLE_ARITHMETIC 0
+#endif
 #endif
 
-/* Quickly detect INFINITY and NAN. */
+/* Define the maximum number of significant digits that are kept in
+ * the 64-bit mantissa of a float. A longer mantissa is truncated, and
+ * if the truncation could affect the rounding all digits are compared
+ * exactly against the halfway point with a (slower) big integer.
+ */
+#define FN_MAX_MANTISSA_DIGITS 19
+
+/* Quickly detect INFINITY and NAN. The length is checked first,
+ * so nothing past the end is read.
+ */
 #define _quick_detect_nf(start, len) \
     ((len) == 3 && \
      ((start)[1] == 'n' || (start)[1] == 'N') && \
@@ -115,53 +131,132 @@ extern "C" {
      ((start)[6] == 't' || (start)[6] == 'T') && \
      ((start)[7] == 'y' || (start)[7] == 'Y'))
 #define quick_detect_infinity(start, len) \
-    (((start)[0] == 'i' || (start)[0] == 'I') && \
+    ((len) > 0 && ((start)[0] == 'i' || (start)[0] == 'I') && \
      (_quick_detect_nf(start, len) || _quick_detect_nfinity(start, len)))
 #define quick_detect_nan(start, len) \
-    (((start)[0] == 'n' || (start)[0] == 'N') && \
-     (len) == 3 && \
+    ((len) == 3 && \
+     ((start)[0] == 'n' || (start)[0] == 'N') && \
      ((start)[1] == 'a' || (start)[1] == 'A') && \
      ((start)[2] == 'n' || (start)[2] == 'N'))
 
-/* Quickly detect if a string is an integer or float. */
-#define is_likely_int(start, len) ((len) > 0 && is_valid_digit(start))
-#define is_likely_float(start, len) \
-    ((len) > 0 && \
-     (is_valid_digit(start) || \
-      (*(start) == '.' && is_valid_digit((start) + 1))) \
-    )
 
-/* Guess if an int or float will overflow. */
-#define int_might_overflow(start, end) ((end) - (start)) > FN_MAX_INT_LEN
+/* What a string contains, as found by tokenize_number. */
+typedef enum NumberKind {
+    FN_NOT_NUMBER,
+    FN_INT,            /* Only digits. */
+    FN_INTLIKE_FLOAT,  /* A float with an integral value, e.g. 1.0 or 1e5. */
+    FN_FLOAT,
+    FN_INFINITY,
+    FN_NAN
+} NumberKind;
 
-bool
-float_might_overflow(register const char *start,
-                     register const Py_ssize_t len);
+/* A string scanned by tokenize_number. Spans are given by start (first
+ * character) and end (one past the last character) pointers, and may
+ * contain underscores between digits if they were allowed.
+ * The mantissa holds the first FN_MAX_MANTISSA_DIGITS significant
+ * digits; any dropped digits are counted in adjust, and if any were
+ * non-zero the mantissa is marked as truncated. The value of the
+ * number is then (approximately) mantissa * 10**(expon + adjust).
+ */
+typedef struct NumberToken {
+    NumberKind kind;
+    int8_t sign;                /* -1 or 1. */
+    const char *int_start;      /* Digits before the decimal point. */
+    const char *int_end;
+    const char *frac_start;     /* Digits after the decimal point. */
+    const char *frac_end;
+    int64_t expon;              /* Saturated at +/-FN_MAX_EXPON. */
+    uint64_t mantissa;
+    int64_t adjust;             /* Decimal places, less any dropped digits. */
+    bool truncated;
+    Py_ssize_t int_underscores;      /* Underscores in each span. */
+    Py_ssize_t frac_underscores;
+    Py_ssize_t int_trailing_zeros;   /* Only for floats. */
+    Py_ssize_t frac_trailing_zeros;  /* Only for floats. */
+} NumberToken;
+
+/* Exponents saturate here. This is far beyond the length of any
+ * string, so the digits can never cancel out enough of a saturated
+ * exponent to make it matter.
+ */
+#define FN_MAX_EXPON INT64_C(0x10000000000)
 
+/* How much of a NumberToken tokenize_number must fill in. */
+typedef enum TokenDetail {
+    FN_DETAIL_ALL,     /* Every field, to convert the number. */
+    FN_DETAIL_KIND,    /* Only the kind. */
+    FN_DETAIL_NUMBER   /* Only the kind, without telling int-like
+                        * floats from other floats. */
+} TokenDetail;
+
+/* How the conversion of a string turned out. */
+typedef enum FnStatus {
+    FN_STATUS_INT,       /* An int held in value.magnitude. */
+    FN_STATUS_LONG_INT,  /* An int too long for that, in value.digits. */
+    FN_STATUS_FLOAT,     /* A float held in value.real. */
+    FN_STATUS_INFINITY,  /* Infinity spelled out, in value.real. */
+    FN_STATUS_NAN,       /* NaN, in value.real. */
+    FN_STATUS_INVALID    /* Not a number of the type asked for. */
+} FnStatus;
+
+/* The digits of an int too long to hold in a fn_uint_t, which only
+ * Python can convert. In base 10 the int is the first ndigits
+ * significant digits from start to end - skipping underscores, a
+ * decimal point and leading zeros - padded with zeros if they run
+ * out, and length digits count towards sys.get_int_max_str_digits.
+ * In any other base the span is the whole string, for Python's parser.
+ */
+typedef struct FnDigits {
+    const char *start;
+    const char *end;
+    Py_ssize_t ndigits;
+    Py_ssize_t length;
+    int base;
+} FnDigits;
+
+/* The result of converting a string, which involves no Python objects
+ * (so can be found without holding the GIL).
+ */
+typedef struct FnResult {
+    FnStatus status;
+    int8_t sign;  /* -1 or 1. */
+    union {
+        fn_uint_t magnitude;
+        double real;
+        FnDigits digits;
+    } value;
+} FnResult;
 
 /* Declarations. */
 
 bool
 is_valid_digit_arbitrary_base(const char c, const int base);
 
-long
-parse_int(register const char *str, register const char *end, bool *error);
+void
+tokenize_number(register const char *str, register const char *end,
+                NumberToken *token, const TokenDetail detail,
+                const bool allow_underscores);
+
+void
+tokenize_trusted_number(register const char *str, register const char *end,
+                        NumberToken *token, const TokenDetail detail);
 
 double
-parse_float(register const char *str, register const char *end, bool *error,
-            const int8_t sign);
+number_token_to_double(const NumberToken *token, const bool exact);
 
-bool
-string_contains_float(register const char *str, register const char *end,
-                      const bool allow_inf, const bool allow_nan);
+FnResult
+parse_int(register const char *str, register const char *end);
 
-bool
-string_contains_intlike_float(register const char *str,
-                              register const char *end);
+Py_ssize_t
+parse_int_to_limbs(const char *str, const char *end, uint64_t *limbs);
+
+FnResult
+parse_int_in_base(register const char *str, register const char *end,
+                  int base, const bool allow_underscores);
 
 bool
 string_contains_int(register const char *str, register const char *end,
-                    int base);
+                    int base, const bool allow_underscores);
 
 #ifdef __cplusplus
 } /* extern "C" */
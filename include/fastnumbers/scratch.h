@@ -0,0 +1,80 @@
+#ifndef __FN_SCRATCH
+#define __FN_SCRATCH
+
+/*
+ * Per-thread scratch space for the string parsers, so that a copy of
+ * a string (or the like) needs no allocation of its own. Space is
+ * reserved by bumping a pointer, and released back to a mark.
+ */
+
+#include <Python.h>
+#include "fastnumbers/pstdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Compilers without thread-local storage share one scratch space,
+ * which is safe as long as a single GIL is held while it is used.
+ * FN_SCRATCH_PER_THREAD says whether each thread has its own.
+ */
+#if defined(_MSC_VER)
+#define FN_THREAD_LOCAL __declspec(thread)
+#define FN_SCRATCH_PER_THREAD 1
+#elif defined(__GNUC__) || defined(__clang__)
+#define FN_THREAD_LOCAL __thread
+#define FN_SCRATCH_PER_THREAD 1
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define FN_THREAD_LOCAL _Thread_local
+#define FN_SCRATCH_PER_THREAD 1
+#else
+#define FN_THREAD_LOCAL
+#define FN_SCRATCH_PER_THREAD 0
+#endif
+
+/* The size of the first chunk of scratch space - reservations that
+ * are larger get a chunk of their own.
+ */
+#define FN_SCRATCH_CHUNK_SIZE 4096
+
+/* The largest chunk that is kept for the next call once released.
+ * Anything larger is given back to the system.
+ */
+#define FN_SCRATCH_MAX_KEPT (64 * 1024)
+
+/* A position in the scratch space. */
+typedef struct ScratchMark {
+    struct ScratchChunk *chunk;
+    size_t used;
+} ScratchMark;
+
+/* Declarations */
+
+/* Remember the current position in this thread's scratch space,
+ * to release everything reserved after it later on.
+ */
+void
+scratch_mark(ScratchMark *mark);
+
+/* Reserve size bytes of this thread's scratch space, aligned for any
+ * type. The space is valid until released. Returns NULL and sets a
+ * MemoryError if it could not be found.
+ */
+void *
+scratch_reserve(const size_t size);
+
+/* Release everything reserved since the mark was taken. */
+void
+scratch_release(const ScratchMark *mark);
+
+/* How many times this thread has had to allocate scratch space on
+ * the heap.
+ */
+Py_ssize_t
+scratch_heap_allocations(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_SCRATCH */
@@ -0,0 +1,29 @@
+#ifndef __FN_STATE
+#define __FN_STATE
+
+/*
+ * The state of a fastnumbers module. Each interpreter that imports it
+ * gets a module of its own, so the Python objects the functions need
+ * are kept here rather than in C statics, which every interpreter
+ * would share.
+ */
+
+#include <Python.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FastnumbersState {
+    PyObject *invalid_number_error;  /* The InvalidNumberError type. */
+} FastnumbersState;
+
+/* The state of the given fastnumbers module. */
+#define fastnumbers_state(module) \
+    ((FastnumbersState *) PyModule_GetState(module))
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_STATE */
@@ -7,6 +7,7 @@
 
 #include <Python.h>
 #include "fastnumbers/options.h"
+#include "fastnumbers/parsing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,16 +15,39 @@ extern "C" {
 
 /* Declarations */
 
-PyObject *
+/* Each of these returns 1 with the answer in result, 0 if obj is not
+ * a string, or -1 with an exception set. An invalid number is NULL in
+ * result, for the caller to handle (an exception is set if raising).
+ */
+int
 PyString_to_PyNumber(PyObject *obj, const PyNumberType type,
-                     const Options *options);
+                     const Options *options, PyObject **result);
 
-PyObject *
+int
 PyString_is_number(PyObject *obj, const PyNumberType type,
-                   const Options *options);
+                   const Options *options, bool *result);
+
+int
+PyString_contains_type(PyObject *obj, const Options *options,
+                       PyObject **result);
+
+/* Converting strings without the GIL. The characters of strings that
+ * PyString_stable_chars accepts are parsed by string_to_result, which
+ * uses no Python objects, and the number is then built by
+ * PyString_result_to_PyNumber with the GIL held again.
+ */
+const char *
+PyString_stable_chars(PyObject *obj, const PyNumberType type,
+                      const Options *options, const char **end);
+
+FnResult
+string_to_result(const char *str, const char *end, const PyNumberType type,
+                 const Options *options);
 
 PyObject *
-PyString_contains_type(PyObject *obj, const Options *options);
+PyString_result_to_PyNumber(const FnResult *result, const char *str,
+                            const char *end, const PyNumberType type,
+                            const Options *options);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -0,0 +1,53 @@
+#ifndef __FN_TABLES
+#define __FN_TABLES
+
+/*
+ * Lookup tables for the number parsers (see dev/generate_tables.py).
+ */
+
+#include "fastnumbers/fn_bool.h"
+#include "fastnumbers/pstdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Range of decimal exponents covered by the power-of-five table. */
+#define FN_SMALLEST_POWER_OF_FIVE -342
+#define FN_LARGEST_POWER_OF_FIVE 308
+
+/* Marks a character that is not a digit in any base. */
+#define FN_INVALID_DIGIT 0xFF
+
+/* Layout of the Unicode numeric table: code points are grouped in
+ * blocks of 1 << FN_UNICODE_BLOCK_SHIFT, and each is classed as not
+ * numeric, unassigned (so unknown to the table), or as the numeric
+ * value at its class minus FN_UNICODE_FIRST_NUMERIC.
+ */
+#define FN_UNICODE_BLOCK_SHIFT 7
+#define FN_UNICODE_NOT_NUMERIC 0
+#define FN_UNICODE_UNASSIGNED 1
+#define FN_UNICODE_FIRST_NUMERIC 2
+
+/* The numeric value of a character, and whether Python treats it
+ * as an int (it is a digit) and whether the value is a whole number.
+ */
+typedef struct UnicodeNumeric {
+    double value;
+    bool is_int;
+    bool is_intlike;
+} UnicodeNumeric;
+
+/* Declarations */
+
+extern const uint64_t fn_power_of_five_128[];
+extern const uint8_t fn_digit_value[256];
+extern const uint8_t fn_unicode_numeric_block[];
+extern const uint8_t fn_unicode_numeric_class[];
+extern const UnicodeNumeric fn_unicode_numeric_value[];
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __FN_TABLES */
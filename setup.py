@@ -4,9 +4,55 @@
 # Std lib imports
 import glob
 import os
+import shutil
+import subprocess
+import tempfile
 
 # Non-std lib imports
 from setuptools import Extension, find_packages, setup
+from setuptools.command.build_ext import build_ext
+
+
+class build_ext_with_probe(build_ext):
+    """
+    Build the extension with float parsing limits measured on this platform.
+
+    src/probe/float_limits.c is compiled and run with the same compiler
+    and flags as the extension, and each "NAME VALUE" line it prints is
+    passed to the extension as a macro. If the probe cannot be built or
+    run (e.g. when cross-compiling), the limits are left to the
+    compiler-based defaults in parsing.h.
+    """
+
+    def build_extensions(self):
+        macros = self.probe_float_limits()
+        for ext in self.extensions:
+            ext.define_macros.extend(macros)
+        super().build_extensions()
+
+    def probe_float_limits(self):
+        tmpdir = tempfile.mkdtemp()
+        try:
+            objects = self.compiler.compile(
+                [os.path.join("src", "probe", "float_limits.c")],
+                output_dir=tmpdir,
+                extra_postargs=self.extensions[0].extra_compile_args,
+            )
+            self.compiler.link_executable(objects, "float_limits", output_dir=tmpdir)
+            program = os.path.join(
+                tmpdir, self.compiler.executable_filename("float_limits")
+            )
+            output = subprocess.run(
+                [program], stdout=subprocess.PIPE, check=True, timeout=60
+            ).stdout.decode()
+            macros = [tuple(line.split()) for line in output.splitlines()]
+        except Exception as e:  # Anything at all means no probed limits.
+            print("warning: float limits could not be probed ({})".format(e))
+            return []
+        finally:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+        print("probed float limits: {}".format(macros))
+        return macros
 
 
 # Define how to build the extension module.
@@ -19,6 +65,7 @@ setup(
     package_dir={"": "src"},
     package_data={"fastnumbers": ["py.typed", "*.pyi"]},
     zip_safe=False,
+    cmdclass={"build_ext": build_ext_with_probe},
     ext_modules=[
         Extension(
             "fastnumbers.fastnumbers",
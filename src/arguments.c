@@ -0,0 +1,153 @@
+/* Argument parsing for fastcall functions.
+ *
+ * The arguments are matched to the parameters in a single pass, and
+ * keywords are found by comparing their characters to the parameter
+ * names (which are short and all ASCII). The errors are those
+ * PyArg_ParseTupleAndKeywords would give.
+ */
+#include <Python.h>
+#include <stdarg.h>
+#include <string.h>
+#include "fastnumbers/arguments.h"
+#include "fastnumbers/fn_bool.h"
+
+
+/* Forward declarations */
+static Py_ssize_t
+find_keyword(const FnSignature *signature, PyObject *name);
+static int
+store_argument(const FnParameter *parameter, PyObject *value, void *target);
+
+
+int
+fn_parse_arguments(const FnSignature *signature, PyObject *const *args,
+                   const Py_ssize_t nargs, PyObject *kwnames, ...)
+{
+    PyObject *values[FN_MAX_PARAMETERS] = { NULL };
+    const Py_ssize_t nkwargs = kwnames == NULL ? 0 : PyTuple_GET_SIZE(kwnames);
+    Py_ssize_t i;
+    va_list targets;
+
+    /* Match the arguments to the parameters. Parameters that can only
+     * be given by position come first, so if the last one is such then
+     * no keywords are taken at all.
+     */
+    if (nkwargs > 0 && signature->parameters[signature->nparameters - 1]
+            .name[0] == '\0') {
+        PyErr_Format(PyExc_TypeError, "%.200s() takes no keyword arguments",
+                     signature->fname);
+        return -1;
+    }
+    if (nargs + nkwargs > signature->nparameters) {
+        PyErr_Format(PyExc_TypeError,
+                     "%.200s() takes at most %zd %sargument%s (%zd given)",
+                     signature->fname, signature->nparameters,
+                     nargs == 0 ? "keyword " : "",
+                     signature->nparameters == 1 ? "" : "s", nargs + nkwargs);
+        return -1;
+    }
+    if (nargs > signature->npositional) {
+        PyErr_Format(PyExc_TypeError,
+                     "%.200s() takes at most %zd positional argument%s "
+                     "(%zd given)", signature->fname, signature->npositional,
+                     signature->npositional == 1 ? "" : "s", nargs);
+        return -1;
+    }
+    for (i = 0; i < nargs; i++) {
+        values[i] = args[i];
+    }
+    for (i = 0; i < nkwargs; i++) {
+        PyObject *name = PyTuple_GET_ITEM(kwnames, i);
+        const Py_ssize_t index = find_keyword(signature, name);
+        if (index < 0) {
+            PyErr_Format(PyExc_TypeError,
+                         "'%S' is an invalid keyword argument for %.200s()",
+                         name, signature->fname);
+            return -1;
+        }
+        if (values[index] != NULL) {
+            PyErr_Format(PyExc_TypeError,
+                         "argument for %.200s() given by name ('%s') and "
+                         "position (%zd)", signature->fname,
+                         signature->parameters[index].name, index + 1);
+            return -1;
+        }
+        values[index] = args[nargs + i];
+    }
+    for (i = 0; i < signature->nrequired; i++) {
+        if (values[i] == NULL) {
+            PyErr_Format(PyExc_TypeError,
+                         "%.200s() missing required argument '%s' (pos %zd)",
+                         signature->fname, signature->parameters[i].name,
+                         i + 1);
+            return -1;
+        }
+    }
+
+    /* Store those that were given. */
+    va_start(targets, kwnames);
+    for (i = 0; i < signature->nparameters; i++) {
+        void *target = va_arg(targets, void *);
+        if (values[i] != NULL &&
+                store_argument(&signature->parameters[i], values[i],
+                               target) < 0) {
+            va_end(targets);
+            return -1;
+        }
+    }
+    va_end(targets);
+    return 0;
+}
+
+
+/* The index of the parameter with this name, or -1 if none. Those
+ * that can only be given by position have no name to match.
+ */
+static Py_ssize_t
+find_keyword(const FnSignature *signature, PyObject *name)
+{
+    const char *chars = NULL;
+    Py_ssize_t length = 0;
+    Py_ssize_t i;
+
+#if PY_VERSION_HEX < 0x030C0000
+    if (PyUnicode_READY(name) < 0) {
+        PyErr_Clear();
+        return -1;
+    }
+#endif
+    length = PyUnicode_GET_LENGTH(name);
+    if (length == 0 || !PyUnicode_IS_ASCII(name)) {
+        return -1;
+    }
+    chars = (const char *) PyUnicode_DATA(name);
+    for (i = 0; i < signature->nparameters; i++) {
+        const char *parameter = signature->parameters[i].name;
+        if (parameter[0] == chars[0] && strlen(parameter) == (size_t) length
+                && memcmp(parameter, chars, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* Store an argument as the kind its parameter asks for. */
+static int
+store_argument(const FnParameter *parameter, PyObject *value, void *target)
+{
+    int truth;
+    switch (parameter->kind) {
+    case FN_ARG_BOOL:
+        truth = PyObject_IsTrue(value);
+        if (truth < 0) {
+            return -1;
+        }
+        *(int *) target = truth;
+        return 0;
+    case FN_ARG_OBJECT:
+    default:
+        *(PyObject **) target = value;
+        return 0;
+    }
+}
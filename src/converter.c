@@ -0,0 +1,448 @@
+/* Converters: conversion functions with their options bound.
+ *
+ * A Converter reads and checks its options once, when it is created,
+ * into the same Options struct the fast_* functions fill in for each
+ * call. Calling it copies that struct and sets only what depends on
+ * the input. Where Python supports it (3.9 on, for types made from a
+ * spec) it is called with the vectorcall protocol, so a call builds no
+ * argument tuple either.
+ *
+ * The type is made for each module, and its converters raise the
+ * InvalidNumberError of that module.
+ */
+#include <Python.h>
+#include <limits.h>
+#include <stddef.h>
+#include <structmember.h>
+#include "fastnumbers/converter.h"
+#include "fastnumbers/fn_bool.h"
+#include "fastnumbers/fn_inline.h"
+#include "fastnumbers/objects.h"
+#include "fastnumbers/options.h"
+#include "fastnumbers/state.h"
+
+#if PY_VERSION_HEX >= 0x03090000
+#define FN_HAVE_VECTORCALL
+#define FN_TPFLAGS_VECTORCALL Py_TPFLAGS_HAVE_VECTORCALL
+#else
+#define FN_TPFLAGS_VECTORCALL 0
+
+/* Types cannot refer to their module before 3.9, so the module is kept
+ * in the dict of the type under this name instead.
+ */
+#define FN_MODULE_KEY "_fastnumbers_module"
+#endif
+
+/* What a converter converts to, and which of the options that only
+ * some of the fast_* functions take it accepts.
+ */
+typedef struct ConverterKind {
+    const char *name;
+    PyNumberType type;
+    bool floats;  /* Takes inf, nan and precision? */
+    bool coerce;  /* Takes coerce? */
+    bool base;    /* Takes base? */
+} ConverterKind;
+
+static const ConverterKind converter_kinds[] = {
+    {"real", REAL, true, true, false},
+    {"float", FLOAT, true, false, false},
+    {"int", INT, false, false, true},
+    {"forceint", FORCEINT, false, false, false},
+};
+
+#define N_KINDS (sizeof(converter_kinds) / sizeof(converter_kinds[0]))
+
+typedef struct Converter {
+    PyObject_HEAD
+#ifdef FN_HAVE_VECTORCALL
+    vectorcallfunc vectorcall;
+#endif
+    const ConverterKind *kind;
+    Options options;          /* Owns its Python objects but input. */
+    PyObject *default_value;  /* NULL if not given. */
+    bool raise_on_invalid;
+} Converter;
+
+
+/* Forward declarations */
+static const ConverterKind *
+find_kind(PyObject *pykind);
+static int
+check_not_given(const ConverterKind *kind, const char *name, PyObject *value);
+static PyObject *
+converter_module(PyTypeObject *type);
+#ifdef FN_HAVE_VECTORCALL
+static PyObject *
+Converter_vectorcall(Converter *self, PyObject *const *args, size_t nargsf,
+                     PyObject *kwnames);
+#endif
+
+
+/* Convert the input as the fast_* function for this kind would with
+ * the options of the converter.
+ */
+FN_INLINE(PyObject *)
+convert(const Converter *self, PyObject *input)
+{
+    Options opts = self->options;
+    Options_Set_Return_Value(opts, input, self->default_value,
+                             self->raise_on_invalid);
+    return PyObject_to_PyNumber(input, self->kind->type, &opts);
+}
+
+
+/* The kind with the given name. Returns NULL with an exception set if
+ * there is none.
+ */
+static const ConverterKind *
+find_kind(PyObject *pykind)
+{
+    size_t i;
+    if (PyUnicode_Check(pykind)) {
+        for (i = 0; i < N_KINDS; i++) {
+            if (PyUnicode_CompareWithASCIIString(
+                        pykind, converter_kinds[i].name) == 0) {
+                return &converter_kinds[i];
+            }
+        }
+    }
+    PyErr_Format(PyExc_ValueError,
+                 "kind must be 'real', 'float', 'int' or 'forceint', not %R",
+                 pykind);
+    return NULL;
+}
+
+
+/* The module a Converter type was made for (a borrowed reference).
+ * Returns NULL with an exception set if there is none.
+ */
+static PyObject *
+converter_module(PyTypeObject *type)
+{
+#ifdef FN_HAVE_VECTORCALL
+    return PyType_GetModule(type);
+#else
+    PyObject *module = PyDict_GetItemString(type->tp_dict, FN_MODULE_KEY);
+    if (module == NULL) {
+        PyErr_SetString(PyExc_TypeError, "no fastnumbers module");
+    }
+    return module;
+#endif
+}
+
+
+/* Raise a TypeError if an option this kind does not take was given.
+ * Returns -1 if so, else 0.
+ */
+static int
+check_not_given(const ConverterKind *kind, const char *name, PyObject *value)
+{
+    if (value != NULL) {
+        PyErr_Format(PyExc_TypeError,
+                     "'%s' is an invalid keyword argument for "
+                     "Converter(kind='%s')", name, kind->name);
+        return -1;
+    }
+    return 0;
+}
+
+
+static PyObject *
+Converter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = {
+        "kind", "default", "raise_on_invalid", "on_fail", "inf", "nan",
+        "coerce", "allow_underscores", "base", "precision", "trusted", NULL
+    };
+    PyObject *pykind = NULL;
+    PyObject *default_value = NULL;
+    PyObject *pycoerce = NULL;
+    PyObject *base = NULL;
+    PyObject *precision = NULL;
+    int raise_on_invalid = false;
+    Options opts = init_Options_convert;
+    const ConverterKind *kind = NULL;
+    PyObject *module = NULL;
+    Converter *self = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$OpOOOOpOOp:Converter",
+                                     keywords, &pykind, &default_value,
+                                     &raise_on_invalid, &opts.on_fail,
+                                     &opts.handle_inf, &opts.handle_nan,
+                                     &pycoerce, &opts.allow_underscores,
+                                     &base, &precision, &opts.trusted)) {
+        return NULL;
+    }
+    kind = find_kind(pykind);
+    if (kind == NULL) {
+        return NULL;
+    }
+
+    /* Only take the options the fast_* function of this kind does. */
+    if (!kind->floats && (check_not_given(kind, "inf", opts.handle_inf) ||
+                          check_not_given(kind, "nan", opts.handle_nan) ||
+                          check_not_given(kind, "precision", precision))) {
+        return NULL;
+    }
+    if (!kind->coerce && check_not_given(kind, "coerce", pycoerce)) {
+        return NULL;
+    }
+    if (!kind->base && check_not_given(kind, "base", base)) {
+        return NULL;
+    }
+    if (pycoerce != NULL) {
+        opts.coerce = PyObject_IsTrue(pycoerce);
+        if (opts.coerce < 0) {
+            return NULL;
+        }
+    }
+    if (assess_integer_base_input(base, &opts.base)) {
+        return NULL;
+    }
+    if (assess_precision_input(precision, &opts.exact)) {
+        return NULL;
+    }
+    if ((module = converter_module(type)) == NULL) {
+        return NULL;
+    }
+    opts.error_type = fastnumbers_state(module)->invalid_number_error;
+
+    self = (Converter *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+#ifdef FN_HAVE_VECTORCALL
+    self->vectorcall = (vectorcallfunc) Converter_vectorcall;
+#endif
+    self->kind = kind;
+    Py_XINCREF(opts.on_fail);
+    Py_XINCREF(opts.handle_inf);
+    Py_XINCREF(opts.handle_nan);
+    Py_INCREF(opts.error_type);
+    self->options = opts;
+    Py_XINCREF(default_value);
+    self->default_value = default_value;
+    self->raise_on_invalid = raise_on_invalid;
+    return (PyObject *) self;
+}
+
+
+static int
+Converter_traverse(Converter *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->options.on_fail);
+    Py_VISIT(self->options.handle_inf);
+    Py_VISIT(self->options.handle_nan);
+    Py_VISIT(self->options.error_type);
+    Py_VISIT(self->default_value);
+#if PY_VERSION_HEX >= 0x03090000
+    Py_VISIT(Py_TYPE(self));  /* Instances of heap types refer to it. */
+#endif
+    return 0;
+}
+
+
+static int
+Converter_clear(Converter *self)
+{
+    Py_CLEAR(self->options.on_fail);
+    Py_CLEAR(self->options.handle_inf);
+    Py_CLEAR(self->options.handle_nan);
+    Py_CLEAR(self->options.error_type);
+    Py_CLEAR(self->default_value);
+    return 0;
+}
+
+
+static void
+Converter_dealloc(Converter *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Converter_clear(self);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+
+static PyObject *
+Converter_repr(Converter *self)
+{
+    return PyUnicode_FromFormat("<fastnumbers.Converter kind='%s'>",
+                                self->kind->name);
+}
+
+
+static PyObject *
+Converter_call(Converter *self, PyObject *args, PyObject *kwargs)
+{
+    if (kwargs != NULL && PyDict_Size(kwargs) > 0) {
+        PyErr_SetString(PyExc_TypeError,
+                        "Converter() takes no keyword arguments");
+        return NULL;
+    }
+    if (PyTuple_GET_SIZE(args) != 1) {
+        PyErr_Format(PyExc_TypeError,
+                     "Converter() takes exactly one argument (%zd given)",
+                     PyTuple_GET_SIZE(args));
+        return NULL;
+    }
+    return convert(self, PyTuple_GET_ITEM(args, 0));
+}
+
+
+#ifdef FN_HAVE_VECTORCALL
+static PyObject *
+Converter_vectorcall(Converter *self, PyObject *const *args, size_t nargsf,
+                     PyObject *kwnames)
+{
+    const Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+    if (kwnames != NULL && PyTuple_GET_SIZE(kwnames) > 0) {
+        PyErr_SetString(PyExc_TypeError,
+                        "Converter() takes no keyword arguments");
+        return NULL;
+    }
+    if (nargs != 1) {
+        PyErr_Format(PyExc_TypeError,
+                     "Converter() takes exactly one argument (%zd given)",
+                     nargs);
+        return NULL;
+    }
+    return convert(self, args[0]);
+}
+#endif
+
+
+PyDoc_STRVAR(Converter_map__doc__,
+"map(values)\n"
+"Convert each of *values*, returning a list.\n"
+"\n"
+"The result is the same as ``[converter(x) for x in values]``, but\n"
+"strings (``str`` of ASCII characters, and ``bytes``) are parsed in\n"
+"blocks, which release the GIL while they are parsed if they are\n"
+"large enough.\n"
+"\n"
+"    >>> from fastnumbers import Converter\n"
+"    >>> Converter('real').map(['1', b'2.5', 3, '4e2'])\n"
+"    [1, 2.5, 3, 400]\n"
+"\n");
+
+static PyObject *
+Converter_map(Converter *self, PyObject *values)
+{
+    PyObject *items = PySequence_Tuple(values);
+    PyObject *results = NULL;
+    if (items == NULL) {
+        return NULL;
+    }
+    results = PyTuple_to_PyNumbers(items, self->kind->type, &self->options,
+                                   self->default_value,
+                                   self->raise_on_invalid);
+    Py_DECREF(items);
+    return results;
+}
+
+
+static PyMethodDef Converter_methods[] = {
+    {"map", (PyCFunction) Converter_map, METH_O, Converter_map__doc__},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+
+static PyObject *
+Converter_get_kind(Converter *self, void *Py_UNUSED(closure))
+{
+    return PyUnicode_FromString(self->kind->name);
+}
+
+
+static PyGetSetDef Converter_getset[] = {
+    {
+        "kind", (getter) Converter_get_kind, NULL,
+        "What the input is converted to: 'real', 'float', 'int' or "
+        "'forceint'.", NULL
+    },
+    {NULL, NULL, NULL, NULL, NULL} /* Sentinel */
+};
+
+PyDoc_STRVAR(Converter__doc__,
+"Converter(kind, *, default=None, raise_on_invalid=False, on_fail=None, inf=None, nan=None, coerce=True, allow_underscores=True, base=10, precision='exact', trusted=False)\n"
+"A conversion function with its options given ahead of time.\n"
+"\n"
+"Calling ``Converter(kind, **options)`` with a single input returns\n"
+"the same as calling ``fast_<kind>`` with that input and those options,\n"
+"but the options are only read and checked once, when the converter\n"
+"is made, instead of on every call. Use one to convert many inputs\n"
+"with the same options.\n"
+"\n"
+"Parameters\n"
+"----------\n"
+"kind : {'real', 'float', 'int', 'forceint'}\n"
+"    Which of `fast_real`, `fast_float`, `fast_int` or `fast_forceint`\n"
+"    to behave like.\n"
+"**options\n"
+"    The keyword arguments of that function. Only those that it takes\n"
+"    are allowed - e.g. *base* only for *'int'*.\n"
+"\n"
+"Examples\n"
+"--------\n"
+"\n"
+"    >>> from fastnumbers import Converter\n"
+"    >>> to_float = Converter('float', default=0.0)\n"
+"    >>> [to_float(x) for x in ['1', '2.5', 'n/a']]\n"
+"    [1.0, 2.5, 0.0]\n"
+"    >>> from_hex = Converter('int', base=16, on_fail=len)\n"
+"    >>> [from_hex(x) for x in ['ff', '0x10', 'invalid']]\n"
+"    [255, 16, 7]\n"
+"\n");
+
+#ifdef FN_HAVE_VECTORCALL
+static PyMemberDef Converter_members[] = {
+    {
+        "__vectorcalloffset__", T_PYSSIZET, offsetof(Converter, vectorcall),
+        READONLY, NULL
+    },
+    {NULL, 0, 0, 0, NULL} /* Sentinel */
+};
+#endif
+
+static PyType_Slot Converter_slots[] = {
+    {Py_tp_dealloc, (void *) Converter_dealloc},
+    {Py_tp_repr, (void *) Converter_repr},
+    {Py_tp_call, (void *) Converter_call},
+    {Py_tp_doc, (void *) Converter__doc__},
+    {Py_tp_traverse, (void *) Converter_traverse},
+    {Py_tp_clear, (void *) Converter_clear},
+#ifdef FN_HAVE_VECTORCALL
+    {Py_tp_members, Converter_members},
+#endif
+    {Py_tp_methods, Converter_methods},
+    {Py_tp_getset, Converter_getset},
+    {Py_tp_new, (void *) Converter_new},
+    {0, NULL} /* Sentinel */
+};
+
+static PyType_Spec Converter_spec = {
+    "fastnumbers.Converter",
+    sizeof(Converter),
+    0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | FN_TPFLAGS_VECTORCALL,
+    Converter_slots,
+};
+
+
+PyObject *
+converter_new_type(PyObject *module)
+{
+#ifdef FN_HAVE_VECTORCALL
+    return PyType_FromModuleAndSpec(module, &Converter_spec, NULL);
+#else
+    PyObject *type = PyType_FromSpec(&Converter_spec);
+    if (type != NULL && PyDict_SetItemString(((PyTypeObject *) type)->tp_dict,
+                                             FN_MODULE_KEY, module) < 0) {
+        Py_CLEAR(type);
+    }
+    return type;
+#endif
+}
@@ -0,0 +1,309 @@
+/* The exception for invalid numbers.
+ *
+ * An InvalidNumberError is raised with empty args, holding on to the
+ * input and base instead. Everything that reads the args of an
+ * exception (str, repr, pickling, and the args attribute itself) is
+ * wrapped so that the message is formatted and stored in the args
+ * first, which makes it indistinguishable from one raised with the
+ * message in the first place.
+ *
+ * Each module (one per interpreter that imports it) creates a type of
+ * its own from the spec, which the conversion functions find in the
+ * module state.
+ */
+#include <Python.h>
+#include <structmember.h>
+#include "fastnumbers/exceptions.h"
+#include "fastnumbers/fn_bool.h"
+
+/* The messages Python gives for the same errors. */
+#define FN_FLOAT_MSG "could not convert string to float: %R"
+#define FN_INT_MSG "invalid literal for int() with base %d: %R"
+
+#define BASE_TYPE ((PyTypeObject *) PyExc_ValueError)
+
+/* Formatting the message replaces the args, so it must not race with
+ * reading them in a free-threaded build. Critical sections (Python
+ * 3.13+) lock the exception there, and do nothing otherwise.
+ */
+#ifdef Py_BEGIN_CRITICAL_SECTION
+#define FN_BEGIN_CRITICAL_SECTION(op) Py_BEGIN_CRITICAL_SECTION(op)
+#define FN_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
+#else
+#define FN_BEGIN_CRITICAL_SECTION(op) {
+#define FN_END_CRITICAL_SECTION() }
+#endif
+
+typedef struct InvalidNumberError {
+    PyException_HEAD
+    PyObject *input;  /* NULL unless raised by fastnumbers. */
+    int base;         /* FN_FLOAT_BASE for floats. */
+    bool formatted;   /* Is the message in args yet? */
+} InvalidNumberError;
+
+
+/* Forward declarations */
+static int
+format_message(InvalidNumberError *self);
+
+
+/* Store the message for the input in the args, if not done already.
+ * Returns -1 with an exception set on failure. Must be called in a
+ * critical section on self.
+ */
+static int
+format_message(InvalidNumberError *self)
+{
+    PyObject *message = NULL;
+    PyObject *args = NULL;
+
+    if (self->formatted || self->input == NULL) {
+        return 0;
+    }
+    message = self->base == FN_FLOAT_BASE
+              ? PyUnicode_FromFormat(FN_FLOAT_MSG, self->input)
+              : PyUnicode_FromFormat(FN_INT_MSG, self->base, self->input);
+    if (message == NULL) {
+        return -1;
+    }
+    args = PyTuple_Pack(1, message);
+    Py_DECREF(message);
+    if (args == NULL) {
+        return -1;
+    }
+    Py_XSETREF(self->args, args);
+    self->formatted = true;
+    return 0;
+}
+
+
+static int
+InvalidNumberError_traverse(InvalidNumberError *self, visitproc visit,
+                            void *arg)
+{
+    Py_VISIT(self->input);
+#if PY_VERSION_HEX >= 0x03090000
+    Py_VISIT(Py_TYPE(self));  /* Instances of heap types refer to it. */
+#endif
+    return BASE_TYPE->tp_traverse((PyObject *) self, visit, arg);
+}
+
+
+static int
+InvalidNumberError_clear(InvalidNumberError *self)
+{
+    Py_CLEAR(self->input);
+    return BASE_TYPE->tp_clear((PyObject *) self);
+}
+
+
+static void
+InvalidNumberError_dealloc(InvalidNumberError *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+
+    /* Not untracked here, as the base does so unconditionally (which
+     * would crash on Python 3.6 if done twice).
+     */
+    Py_CLEAR(self->input);
+    BASE_TYPE->tp_dealloc((PyObject *) self);
+
+    /* Release the reference each instance holds on its (heap) type.
+     * Before 3.8 that was left to the dealloc of subclasses.
+     */
+#if PY_VERSION_HEX < 0x03080000
+    if (type->tp_dealloc != (destructor) InvalidNumberError_dealloc) {
+        return;
+    }
+#endif
+    Py_DECREF(type);
+}
+
+
+static PyObject *
+InvalidNumberError_str(InvalidNumberError *self)
+{
+    PyObject *result = NULL;
+    FN_BEGIN_CRITICAL_SECTION(self);
+    if (format_message(self) == 0) {
+        result = BASE_TYPE->tp_str((PyObject *) self);
+    }
+    FN_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject *
+InvalidNumberError_repr(InvalidNumberError *self)
+{
+    PyObject *result = NULL;
+    FN_BEGIN_CRITICAL_SECTION(self);
+    if (format_message(self) == 0) {
+        result = BASE_TYPE->tp_repr((PyObject *) self);
+    }
+    FN_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+/* Same as for any exception, but with the message in the args. */
+static PyObject *
+InvalidNumberError_reduce(InvalidNumberError *self,
+                          PyObject *Py_UNUSED(ignored))
+{
+    PyObject *result = NULL;
+    FN_BEGIN_CRITICAL_SECTION(self);
+    if (format_message(self) == 0) {
+        result = self->dict != NULL && PyDict_Size(self->dict) > 0
+                 ? PyTuple_Pack(3, Py_TYPE(self), self->args, self->dict)
+                 : PyTuple_Pack(2, Py_TYPE(self), self->args);
+    }
+    FN_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static PyObject *
+InvalidNumberError_get_args(InvalidNumberError *self, void *Py_UNUSED(closure))
+{
+    PyObject *result = NULL;
+    FN_BEGIN_CRITICAL_SECTION(self);
+    if (format_message(self) == 0) {
+        result = self->args;
+        Py_INCREF(result);
+    }
+    FN_END_CRITICAL_SECTION();
+    return result;
+}
+
+
+static int
+InvalidNumberError_set_args(InvalidNumberError *self, PyObject *value,
+                            void *Py_UNUSED(closure))
+{
+    PyObject *args = NULL;
+    if (value == NULL) {
+        PyErr_SetString(PyExc_TypeError, "args may not be deleted");
+        return -1;
+    }
+    args = PySequence_Tuple(value);
+    if (args == NULL) {
+        return -1;
+    }
+    FN_BEGIN_CRITICAL_SECTION(self);
+    Py_XSETREF(self->args, args);
+    self->formatted = true;  /* Never replace what was set. */
+    FN_END_CRITICAL_SECTION();
+    return 0;
+}
+
+
+static PyObject *
+InvalidNumberError_get_base(InvalidNumberError *self, void *Py_UNUSED(closure))
+{
+    if (self->input == NULL || self->base == FN_FLOAT_BASE) {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromLong(self->base);
+}
+
+
+static PyMethodDef InvalidNumberError_methods[] = {
+    {"__reduce__", (PyCFunction) InvalidNumberError_reduce, METH_NOARGS, NULL},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+static PyMemberDef InvalidNumberError_members[] = {
+    {
+        "input", T_OBJECT, offsetof(InvalidNumberError, input), READONLY,
+        "The input that is not a valid number, or None."
+    },
+    {NULL, 0, 0, 0, NULL} /* Sentinel */
+};
+
+static PyGetSetDef InvalidNumberError_getset[] = {
+    {
+        "args", (getter) InvalidNumberError_get_args,
+        (setter) InvalidNumberError_set_args, NULL, NULL
+    },
+    {
+        "base", (getter) InvalidNumberError_get_base, NULL,
+        "The base the input is not a valid int in, or None for a float.",
+        NULL
+    },
+    {NULL, NULL, NULL, NULL, NULL} /* Sentinel */
+};
+
+static PyType_Slot InvalidNumberError_slots[] = {
+    {Py_tp_dealloc, (void *) InvalidNumberError_dealloc},
+    {Py_tp_repr, (void *) InvalidNumberError_repr},
+    {Py_tp_str, (void *) InvalidNumberError_str},
+    {
+        Py_tp_doc, (void *)
+        "The input is not a valid number.\n\n"
+        "Raised instead of :class:`ValueError`, of which it is a subclass,\n"
+        "with the same message."
+    },
+    {Py_tp_traverse, (void *) InvalidNumberError_traverse},
+    {Py_tp_clear, (void *) InvalidNumberError_clear},
+    {Py_tp_methods, InvalidNumberError_methods},
+    {Py_tp_members, InvalidNumberError_members},
+    {Py_tp_getset, InvalidNumberError_getset},
+    {0, NULL} /* Sentinel */
+};
+
+static PyType_Spec InvalidNumberError_spec = {
+    "fastnumbers.InvalidNumberError",
+    sizeof(InvalidNumberError),
+    0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    InvalidNumberError_slots,
+};
+
+
+PyObject *
+invalid_number_error_new_type(PyObject *module)
+{
+    PyObject *bases = PyTuple_Pack(1, PyExc_ValueError);
+    PyObject *type = NULL;
+    if (bases == NULL) {
+        return NULL;
+    }
+#if PY_VERSION_HEX >= 0x03090000
+    type = PyType_FromModuleAndSpec(module, &InvalidNumberError_spec, bases);
+#else
+    type = PyType_FromSpecWithBases(&InvalidNumberError_spec, bases);
+#endif
+    Py_DECREF(bases);
+    return type;
+}
+
+
+void
+set_invalid_number_error(PyObject *type, PyObject *input, const int base)
+{
+    PyObject *no_args = PyTuple_New(0);
+    InvalidNumberError *self = NULL;
+    if (no_args == NULL) {
+        return;
+    }
+    self = (InvalidNumberError *) ((PyTypeObject *) type)->tp_new(
+               (PyTypeObject *) type, no_args, NULL
+           );
+    Py_DECREF(no_args);
+    if (self == NULL) {
+        return;
+    }
+    Py_INCREF(input);
+    self->input = input;
+    self->base = base;
+
+    /* A mutable input could change before the message is read, so
+     * only put off formatting the message for str and bytes.
+     */
+    if ((PyUnicode_CheckExact(input) || PyBytes_CheckExact(input))
+            || format_message(self) == 0) {
+        PyErr_SetObject(type, (PyObject *) self);
+    }
+    Py_DECREF(self);
+}
@@ -7,45 +7,17 @@
 #include <Python.h>
 #include <limits.h>
 #include "fastnumbers/version.h"
+#include "fastnumbers/arguments.h"
+#include "fastnumbers/converter.h"
 #include "fastnumbers/docstrings.h"
+#include "fastnumbers/exceptions.h"
 #include "fastnumbers/options.h"
 #include "fastnumbers/objects.h"
 #include "fastnumbers/numbers.h"
 #include "fastnumbers/parsing.h"
-
-
-/* Function to handle the conversion of base to integers.
- * 0 is success, 1 is failure.
- */
-int
-assess_integer_base_input(PyObject *pybase, int *base)
-{
-    Py_ssize_t longbase = 0;
-
-    /* Default to INT_MIN.
-     */
-    if (pybase == NULL) {
-        *base = INT_MIN;
-        return 0;
-    }
-
-    /* Convert to int and check for overflow.
-     */
-    longbase = PyNumber_AsSsize_t(pybase, NULL);
-    if (longbase == -1 && PyErr_Occurred()) {
-        return 1;
-    }
-
-    /* Ensure valid integer in valid range.
-     */
-    if ((longbase != 0 && longbase < 2) || longbase > 36) {
-        PyErr_SetString(PyExc_ValueError,
-                        "int() base must be >= 2 and <= 36");
-        return 1;
-    }
-    *base = (int) longbase;
-    return 0;
-}
+#include "fastnumbers/kernels.h"
+#include "fastnumbers/scratch.h"
+#include "fastnumbers/state.h"
 
 
 /* If key is defined, move the value to on_fail.
@@ -68,30 +40,41 @@ handle_key_backwards_compatibility(PyObject **on_fail, PyObject **key)
 
 /* Quickly convert to an int or float, depending on value. */
 static PyObject *
-fastnumbers_fast_real(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_fast_real(PyObject *self, PyObject *const *args,
+                      Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *default_value = NULL;
     PyObject *key = NULL;
-    int raise_on_invalid =
-        false;  /* cannot use bool with PyArg_ParseTupleAndKeywords */
+    PyObject *precision = NULL;
+    int raise_on_invalid = false;
     Options opts = init_Options_convert;
-    static char *keywords[] = { "x", "default", "raise_on_invalid",
-                                "on_fail", "inf", "nan", "coerce",
-                                "allow_underscores", "key", NULL
-                              };
-    static const char *format = "O|O$pOOOppO:fast_real";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"default", FN_ARG_OBJECT},
+        {"raise_on_invalid", FN_ARG_BOOL}, {"on_fail", FN_ARG_OBJECT},
+        {"inf", FN_ARG_OBJECT}, {"nan", FN_ARG_OBJECT},
+        {"coerce", FN_ARG_BOOL}, {"allow_underscores", FN_ARG_BOOL},
+        {"key", FN_ARG_OBJECT}, {"precision", FN_ARG_OBJECT},
+        {"trusted", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("fast_real",
+                                                      parameters, 1, 2);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &default_value, &raise_on_invalid,
-                                     &opts.on_fail, &opts.handle_inf, &opts.handle_nan,
-                                     &opts.coerce, &opts.allow_underscores, &key)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &default_value, &raise_on_invalid,
+                           &opts.on_fail, &opts.handle_inf, &opts.handle_nan,
+                           &opts.coerce, &opts.allow_underscores, &key,
+                           &precision, &opts.trusted)) {
         return NULL;
     }
     if (handle_key_backwards_compatibility(&opts.on_fail, &key)) {
         return NULL;
     }
+    if (assess_precision_input(precision, &opts.exact)) {
+        return NULL;
+    }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, default_value, raise_on_invalid);
 
     return PyObject_to_PyNumber(input, REAL, &opts);
@@ -100,30 +83,40 @@ fastnumbers_fast_real(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly convert to a float, depending on value. */
 static PyObject *
-fastnumbers_fast_float(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_fast_float(PyObject *self, PyObject *const *args,
+                       Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *default_value = NULL;
     PyObject *key = NULL;
-    int raise_on_invalid =
-        false;  /* cannot use bool with PyArg_ParseTupleAndKeywords */
+    PyObject *precision = NULL;
+    int raise_on_invalid = false;
     Options opts = init_Options_convert;
-    static char *keywords[] = { "x", "default", "raise_on_invalid",
-                                "on_fail", "inf", "nan",
-                                "allow_underscores", "key", NULL
-                              };
-    static const char *format = "O|O$pOOOpO:fast_float";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"default", FN_ARG_OBJECT},
+        {"raise_on_invalid", FN_ARG_BOOL}, {"on_fail", FN_ARG_OBJECT},
+        {"inf", FN_ARG_OBJECT}, {"nan", FN_ARG_OBJECT},
+        {"allow_underscores", FN_ARG_BOOL}, {"key", FN_ARG_OBJECT},
+        {"precision", FN_ARG_OBJECT}, {"trusted", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("fast_float",
+                                                      parameters, 1, 2);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &default_value, &raise_on_invalid,
-                                     &opts.on_fail, &opts.handle_inf, &opts.handle_nan,
-                                     &opts.allow_underscores, &key)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &default_value, &raise_on_invalid,
+                           &opts.on_fail, &opts.handle_inf, &opts.handle_nan,
+                           &opts.allow_underscores, &key, &precision,
+                           &opts.trusted)) {
         return NULL;
     }
     if (handle_key_backwards_compatibility(&opts.on_fail, &key)) {
         return NULL;
     }
+    if (assess_precision_input(precision, &opts.exact)) {
+        return NULL;
+    }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, default_value, raise_on_invalid);
 
     return PyObject_to_PyNumber(input, FLOAT, &opts);
@@ -132,32 +125,36 @@ fastnumbers_fast_float(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly convert to an int, depending on value. */
 static PyObject *
-fastnumbers_fast_int(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_fast_int(PyObject *self, PyObject *const *args,
+                     Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *default_value = NULL;
     PyObject *base = NULL;
     PyObject *key = NULL;
-    int raise_on_invalid =
-        false;  /* cannot use bool with PyArg_ParseTupleAndKeywords */
+    int raise_on_invalid = false;
     Options opts = init_Options_convert;
-    static char *keywords[] = { "x", "default", "raise_on_invalid",
-                                "on_fail", "base",
-                                "allow_underscores", "key", NULL
-
-                              };
-    static const char *format = "O|O$pOOpO:fast_int";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"default", FN_ARG_OBJECT},
+        {"raise_on_invalid", FN_ARG_BOOL}, {"on_fail", FN_ARG_OBJECT},
+        {"base", FN_ARG_OBJECT}, {"allow_underscores", FN_ARG_BOOL},
+        {"key", FN_ARG_OBJECT}, {"trusted", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("fast_int",
+                                                      parameters, 1, 2);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &default_value, &raise_on_invalid,
-                                     &opts.on_fail, &base,
-                                     &opts.allow_underscores, &key)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &default_value, &raise_on_invalid,
+                           &opts.on_fail, &base,
+                           &opts.allow_underscores, &key,
+                           &opts.trusted)) {
         return NULL;
     }
     if (handle_key_backwards_compatibility(&opts.on_fail, &key)) {
         return NULL;
     }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, default_value, raise_on_invalid);
     if (assess_integer_base_input(base, &opts.base)) {
         return NULL;
@@ -169,28 +166,34 @@ fastnumbers_fast_int(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Safely convert to an int (even if in a string and as a float). */
 static PyObject *
-fastnumbers_fast_forceint(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_fast_forceint(PyObject *self, PyObject *const *args,
+                          Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *default_value = NULL;
     PyObject *key = NULL;
-    int raise_on_invalid =
-        false;  /* cannot use bool with PyArg_ParseTupleAndKeywords */
+    int raise_on_invalid = false;
     Options opts = init_Options_convert;
-    static char *keywords[] = { "x", "default", "raise_on_invalid",
-                                "on_fail", "allow_underscores", "key", NULL
-                              };
-    static const char *format = "O|O$pOpO:fast_forceint";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"default", FN_ARG_OBJECT},
+        {"raise_on_invalid", FN_ARG_BOOL}, {"on_fail", FN_ARG_OBJECT},
+        {"allow_underscores", FN_ARG_BOOL}, {"key", FN_ARG_OBJECT},
+        {"trusted", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("fast_forceint",
+                                                      parameters, 1, 2);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &default_value, &raise_on_invalid,
-                                     &opts.on_fail, &opts.allow_underscores, &key)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &default_value, &raise_on_invalid,
+                           &opts.on_fail, &opts.allow_underscores, &key,
+                           &opts.trusted)) {
         return NULL;
     }
     if (handle_key_backwards_compatibility(&opts.on_fail, &key)) {
         return NULL;
     }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, default_value, raise_on_invalid);
 
     return PyObject_to_PyNumber(input, FORCEINT, &opts);
@@ -199,21 +202,24 @@ fastnumbers_fast_forceint(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly determine if the input is a real. */
 static PyObject *
-fastnumbers_isreal(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_isreal(PyObject *self, PyObject *const *args,
+                   Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     Options opts = init_Options_check;
-    static char *keywords[] = { "x", "str_only", "num_only",
-                                "allow_inf", "allow_nan",
-                                "allow_underscores", NULL
-                              };
-    static const char *format = "O|$ppOOp:isreal";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"str_only", FN_ARG_BOOL},
+        {"num_only", FN_ARG_BOOL}, {"allow_inf", FN_ARG_OBJECT},
+        {"allow_nan", FN_ARG_OBJECT}, {"allow_underscores", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("isreal",
+                                                      parameters, 1, 1);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.str_only, &opts.num_only,
-                                     &opts.handle_inf, &opts.handle_nan,
-                                     &opts.allow_underscores)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.str_only, &opts.num_only,
+                           &opts.handle_inf, &opts.handle_nan,
+                           &opts.allow_underscores)) {
         return NULL;
     }
 
@@ -223,21 +229,24 @@ fastnumbers_isreal(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly determine if the input is a float. */
 static PyObject *
-fastnumbers_isfloat(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_isfloat(PyObject *self, PyObject *const *args,
+                    Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     Options opts = init_Options_check;
-    static char *keywords[] = { "x", "str_only", "num_only",
-                                "allow_inf", "allow_nan",
-                                "allow_underscores", NULL
-                              };
-    static const char *format = "O|$ppOOp:isfloat";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"str_only", FN_ARG_BOOL},
+        {"num_only", FN_ARG_BOOL}, {"allow_inf", FN_ARG_OBJECT},
+        {"allow_nan", FN_ARG_OBJECT}, {"allow_underscores", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("isfloat",
+                                                      parameters, 1, 1);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.str_only, &opts.num_only,
-                                     &opts.handle_inf, &opts.handle_nan,
-                                     &opts.allow_underscores)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.str_only, &opts.num_only,
+                           &opts.handle_inf, &opts.handle_nan,
+                           &opts.allow_underscores)) {
         return NULL;
     }
 
@@ -247,20 +256,24 @@ fastnumbers_isfloat(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly determine if the input is an int. */
 static PyObject *
-fastnumbers_isint(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_isint(PyObject *self, PyObject *const *args,
+                  Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *base = NULL;
     Options opts = init_Options_check;
-    static char *keywords[] = { "x", "str_only", "num_only", "base",
-                                "allow_underscores", NULL
-                              };
-    static const char *format = "O|$ppOp:isint";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"str_only", FN_ARG_BOOL},
+        {"num_only", FN_ARG_BOOL}, {"base", FN_ARG_OBJECT},
+        {"allow_underscores", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("isint",
+                                                      parameters, 1, 1);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.str_only, &opts.num_only,
-                                     &base, &opts.allow_underscores)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.str_only, &opts.num_only,
+                           &base, &opts.allow_underscores)) {
         return NULL;
     }
     if (assess_integer_base_input(base, &opts.base)) {
@@ -273,19 +286,22 @@ fastnumbers_isint(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly determine if the input is int-like. */
 static PyObject *
-fastnumbers_isintlike(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_isintlike(PyObject *self, PyObject *const *args,
+                      Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     Options opts = init_Options_check;
-    static char *keywords[] = { "x", "str_only", "num_only",
-                                "allow_underscores", NULL
-                              };
-    static const char *format = "O|$ppp:isintlike";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"str_only", FN_ARG_BOOL},
+        {"num_only", FN_ARG_BOOL}, {"allow_underscores", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("isintlike",
+                                                      parameters, 1, 1);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.str_only, &opts.num_only,
-                                     &opts.allow_underscores)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.str_only, &opts.num_only,
+                           &opts.allow_underscores)) {
         return NULL;
     }
 
@@ -295,25 +311,29 @@ fastnumbers_isintlike(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Quickly detect the type. */
 static PyObject *
-fastnumbers_query_type(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_query_type(PyObject *self, PyObject *const *args,
+                       Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *allowed_types = NULL;
     PyObject *result = NULL;
     Options opts = init_Options_check;
-    static char *keywords[] = { "x", "allow_inf", "allow_nan", "coerce",
-                                "allowed_types", "allow_underscores", NULL
-                              };
-    static const char *format = "O|$OOOOp:type";
+    static const FnParameter parameters[] = {
+        {"x", FN_ARG_OBJECT}, {"allow_inf", FN_ARG_OBJECT},
+        {"allow_nan", FN_ARG_OBJECT}, {"coerce", FN_ARG_BOOL},
+        {"allowed_types", FN_ARG_OBJECT}, {"allow_underscores", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("query_type",
+                                                      parameters, 1, 1);
 
     /* Coerce is false by default here. */
     opts.coerce = false;
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.handle_inf, &opts.handle_nan,
-                                     &opts.coerce, &allowed_types,
-                                     &opts.allow_underscores)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.handle_inf, &opts.handle_nan,
+                           &opts.coerce, &allowed_types,
+                           &opts.allow_underscores)) {
         return NULL;
     }
     // Allowed types must be a non-empty sequence.
@@ -350,26 +370,31 @@ fastnumbers_query_type(PyObject *self, PyObject *args, PyObject *kwargs)
 }
 
 
+/* The name of the number given to the drop-in replacements. */
+#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
+/* Do not accept number as a keyword argument. */
+#define BUILTIN_NUMBER_NAME ""
+#else
+/* Do accept number as a keyword argument. */
+#define BUILTIN_NUMBER_NAME "x"
+#endif
+
+
 /* Drop-in replacement for int, float */
 static PyObject *
-fastnumbers_int(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_int(PyObject *self, PyObject *const *args,
+                Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     PyObject *base = NULL;
     Options opts = init_Options_convert;
-    static const char *format = "|OO:int";
-
-#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
-    /* Do not accept number as a keyword argument. */
-    static char *keywords[] = { "", "base", NULL };
-#else
-    /* Do accept number as a keyword argument. */
-    static char *keywords[] = { "x", "base", NULL };
-#endif
+    static const FnParameter parameters[] = {
+        {BUILTIN_NUMBER_NAME, FN_ARG_OBJECT}, {"base", FN_ARG_OBJECT},
+    };
+    static const FnSignature signature = FN_SIGNATURE("int", parameters, 0, 2);
 
     /* Read the function argument */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &base)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames, &input, &base)) {
         return NULL;
     }
     if (assess_integer_base_input(base, &opts.base)) {
@@ -383,6 +408,7 @@ fastnumbers_int(PyObject *self, PyObject *args, PyObject *kwargs)
         }
         return PyLong_FromLong(0);
     }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, NULL, true);
     Options_Set_Disallow_UnicodeCharacter(&opts);
 
@@ -391,34 +417,27 @@ fastnumbers_int(PyObject *self, PyObject *args, PyObject *kwargs)
 
 
 static PyObject *
-#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
-fastnumbers_float(PyObject *self, PyObject *args)
-#else
-fastnumbers_float(PyObject *self, PyObject *args, PyObject *kwargs)
-#endif
+fastnumbers_float(PyObject *self, PyObject *const *args,
+                  Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     Options opts = init_Options_convert;
-    static const char *format = "|O:float";
-
-#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
-    /* Read the function argument - do not accept it as a keyword argument. */
-    if (!PyArg_ParseTuple(args, format, &input)) {
-        return NULL;
-    }
-#else
-    static char *keywords[] = { "x", NULL };
+    static const FnParameter parameters[] = {
+        {BUILTIN_NUMBER_NAME, FN_ARG_OBJECT},
+    };
+    static const FnSignature signature = FN_SIGNATURE("float",
+                                                      parameters, 0, 1);
 
-    /* Read the function argument - accept it as a keyword argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords, &input)) {
+    /* Read the function argument. */
+    if (fn_parse_arguments(&signature, args, nargs, kwnames, &input)) {
         return NULL;
     }
-#endif
 
     /* No arguments returns 0.0. */
     if (input == NULL) {
         return PyFloat_FromDouble(0.0);
     }
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, NULL, true);
     Options_Set_Disallow_UnicodeCharacter(&opts);
 
@@ -428,29 +447,27 @@ fastnumbers_float(PyObject *self, PyObject *args, PyObject *kwargs)
 
 /* Behaves like float or int, but returns correct type. */
 static PyObject *
-fastnumbers_real(PyObject *self, PyObject *args, PyObject *kwargs)
+fastnumbers_real(PyObject *self, PyObject *const *args,
+                 Py_ssize_t nargs, PyObject *kwnames)
 {
     PyObject *input = NULL;
     Options opts = init_Options_convert;
-    static const char *format = "|O$p:real";
-
-#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
-    /* Do not accept number as a keyword argument. */
-    static char *keywords[] = { "", "coerce", NULL };
-#else
-    /* Do accept number as a keyword argument. */
-    static char *keywords[] = { "x", "coerce", NULL };
-#endif
+    static const FnParameter parameters[] = {
+        {BUILTIN_NUMBER_NAME, FN_ARG_OBJECT}, {"coerce", FN_ARG_BOOL},
+    };
+    static const FnSignature signature = FN_SIGNATURE("real",
+                                                      parameters, 0, 1);
 
     /* Read the function argument. */
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords,
-                                     &input, &opts.coerce)) {
+    if (fn_parse_arguments(&signature, args, nargs, kwnames,
+                           &input, &opts.coerce)) {
         return NULL;
     }
     /* No arguments returns 0.0 or 0 depending on the state of coerce. */
     if (input == NULL)
         return Options_Coerce_True(&opts) ? PyLong_FromLong(0)
                : PyFloat_FromDouble(0.0);
+    opts.error_type = fastnumbers_state(self)->invalid_number_error;
     Options_Set_Return_Value(opts, input, NULL, true);
     Options_Set_Disallow_UnicodeCharacter(&opts);
 
@@ -458,99 +475,182 @@ fastnumbers_real(PyObject *self, PyObject *args, PyObject *kwargs)
 }
 
 
+/* Report the heap allocations made for scratch space. */
+static PyObject *
+fastnumbers_scratch_allocations(PyObject *self, PyObject *unused)
+{
+    return PyLong_FromSsize_t(scratch_heap_allocations());
+}
+
+
 /* This defines the methods contained in this module. */
 static PyMethodDef FastnumbersMethods[] = {
     {   "fast_real", (PyCFunction) fastnumbers_fast_real,
-        METH_VARARGS | METH_KEYWORDS, fast_real__doc__
+        FN_METH_FASTCALL, fast_real__doc__
     },
     {   "fast_float", (PyCFunction) fastnumbers_fast_float,
-        METH_VARARGS | METH_KEYWORDS, fast_float__doc__
+        FN_METH_FASTCALL, fast_float__doc__
     },
     {   "fast_int", (PyCFunction) fastnumbers_fast_int,
-        METH_VARARGS | METH_KEYWORDS, fast_int__doc__
+        FN_METH_FASTCALL, fast_int__doc__
     },
     {   "fast_forceint", (PyCFunction) fastnumbers_fast_forceint,
-        METH_VARARGS | METH_KEYWORDS, fast_forceint__doc__
+        FN_METH_FASTCALL, fast_forceint__doc__
     },
     {   "isreal", (PyCFunction) fastnumbers_isreal,
-        METH_VARARGS | METH_KEYWORDS, isreal__doc__
+        FN_METH_FASTCALL, isreal__doc__
     },
     {   "isfloat", (PyCFunction) fastnumbers_isfloat,
-        METH_VARARGS | METH_KEYWORDS, isfloat__doc__
+        FN_METH_FASTCALL, isfloat__doc__
     },
     {   "isint", (PyCFunction) fastnumbers_isint,
-        METH_VARARGS | METH_KEYWORDS, isint__doc__
+        FN_METH_FASTCALL, isint__doc__
     },
     {   "isintlike", (PyCFunction) fastnumbers_isintlike,
-        METH_VARARGS | METH_KEYWORDS, isintlike__doc__
+        FN_METH_FASTCALL, isintlike__doc__
     },
     {   "query_type", (PyCFunction) fastnumbers_query_type,
-        METH_VARARGS | METH_KEYWORDS, query_type__doc__
+        FN_METH_FASTCALL, query_type__doc__
     },
     {   "int", (PyCFunction) fastnumbers_int,
-        METH_VARARGS | METH_KEYWORDS, fastnumbers_int__doc__
+        FN_METH_FASTCALL, fastnumbers_int__doc__
     },
     {   "float", (PyCFunction) fastnumbers_float,
-#if PY_MAJOR_VERSION > 3 || (PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 7)
-        METH_VARARGS, fastnumbers_float__doc__
-#else
-        METH_VARARGS | METH_KEYWORDS, fastnumbers_float__doc__
-#endif
+        FN_METH_FASTCALL, fastnumbers_float__doc__
     },
     {   "real", (PyCFunction) fastnumbers_real,
-        METH_VARARGS | METH_KEYWORDS, fastnumbers_real__doc__
+        FN_METH_FASTCALL, fastnumbers_real__doc__
+    },
+    {   "scratch_allocations", (PyCFunction) fastnumbers_scratch_allocations,
+        METH_NOARGS, scratch_allocations__doc__
     },
     {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
 
-/* We want a module-level variable that is the version. */
-static PyObject *fastnumbers__version__;
+/* Set up a module: choose the kernels, and add the types and
+ * constants. Each interpreter that imports fastnumbers gets a module
+ * of its own, with the types in its state.
+ */
+static int
+fastnumbers_exec(PyObject *m)
+{
+    FastnumbersState *state = fastnumbers_state(m);
+    PyObject *converter_type = NULL;
 
-/* Some constants that may be useful for debugging. */
-static PyObject *fastnumbers_FN_MAX_INT_LEN;
-static PyObject *fastnumbers_FN_DBL_DIG;
-static PyObject *fastnumbers_FN_MAX_EXP;
-static PyObject *fastnumbers_FN_MIN_EXP;
+    /* Choose the parsing kernels for this CPU. */
+    if (select_kernels() < 0) {
+        return -1;
+    }
+
+    /* Add the exception for invalid numbers. */
+    state->invalid_number_error = invalid_number_error_new_type(m);
+    if (state->invalid_number_error == NULL) {
+        return -1;
+    }
+    Py_INCREF(state->invalid_number_error);
+    if (PyModule_AddObject(m, "InvalidNumberError",
+                           state->invalid_number_error) < 0) {
+        Py_DECREF(state->invalid_number_error);
+        return -1;
+    }
+
+    /* Add the type of converters. */
+    converter_type = converter_new_type(m);
+    if (converter_type == NULL) {
+        return -1;
+    }
+    if (PyModule_AddObject(m, "Converter", converter_type) < 0) {
+        Py_DECREF(converter_type);
+        return -1;
+    }
+
+    /* Add module level constants. The version is a module-level
+     * variable, and the others may be useful for debugging.
+     */
+    if (PyModule_AddStringConstant(m, "__version__",
+                                   FASTNUMBERS_VERSION) < 0 ||
+            PyModule_AddIntConstant(m, "max_int_len", FN_MAX_INT_LEN) < 0 ||
+            PyModule_AddIntConstant(m, "dig", FN_DBL_DIG) < 0 ||
+            PyModule_AddIntConstant(m, "max_exp", FN_MAX_EXP) < 0 ||
+            PyModule_AddIntConstant(m, "min_exp", FN_MIN_EXP) < 0 ||
+            PyModule_AddStringConstant(m, "kernels", kernels->name) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+
+static int
+fastnumbers_traverse(PyObject *m, visitproc visit, void *arg)
+{
+    Py_VISIT(fastnumbers_state(m)->invalid_number_error);
+    return 0;
+}
+
+
+static int
+fastnumbers_clear(PyObject *m)
+{
+    Py_CLEAR(fastnumbers_state(m)->invalid_number_error);
+    return 0;
+}
+
+
+static void
+fastnumbers_free(void *m)
+{
+    fastnumbers_clear((PyObject *) m);
+}
+
+
+/* Nothing the module shares between interpreters is a Python object,
+ * so each can have a GIL of its own - unless scratch space is shared
+ * by all threads, which is only safe under a single GIL.
+ */
+#ifdef Py_mod_multiple_interpreters
+#if FN_SCRATCH_PER_THREAD
+#define FN_MULTIPLE_INTERPRETERS Py_MOD_PER_INTERPRETER_GIL_SUPPORTED
+#else
+#define FN_MULTIPLE_INTERPRETERS Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED
+#endif
+#endif
+
+/* Likewise, the functions need no GIL of their own (in a free-threaded
+ * build) if each thread has its own scratch space. Everything else they
+ * share is constant, or thread-local like errno, and InvalidNumberError
+ * formats its message in a critical section.
+ */
+#if defined(Py_mod_gil) && FN_SCRATCH_PER_THREAD
+#define FN_GIL_NOT_USED 1
+#endif
+
+static PyModuleDef_Slot fastnumbers_slots[] = {
+    {Py_mod_exec, (void *) fastnumbers_exec},
+#ifdef Py_mod_multiple_interpreters
+    {Py_mod_multiple_interpreters, FN_MULTIPLE_INTERPRETERS},
+#endif
+#ifdef FN_GIL_NOT_USED
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL} /* Sentinel */
+};
 
 /* Define the module interface. */
 static struct PyModuleDef moduledef = {
     PyModuleDef_HEAD_INIT,
     "fastnumbers",
     fastnumbers__doc__,
-    -1,
+    sizeof(FastnumbersState),
     FastnumbersMethods,
-    NULL,
-    NULL,
-    NULL,
-    NULL
+    fastnumbers_slots,
+    fastnumbers_traverse,
+    fastnumbers_clear,
+    fastnumbers_free
 };
 
 PyObject *
 PyInit_fastnumbers(void)
 {
-    PyObject *m = PyModule_Create(&moduledef);
-    if (m == NULL) {
-        return NULL;
-    }
-
-    /* Add module level constants. */
-    fastnumbers__version__ = PyUnicode_FromString(FASTNUMBERS_VERSION);
-    fastnumbers_FN_MAX_INT_LEN = PyLong_FromLong(FN_MAX_INT_LEN);
-    fastnumbers_FN_DBL_DIG = PyLong_FromLong(FN_DBL_DIG);
-    fastnumbers_FN_MAX_EXP = PyLong_FromLong(FN_MAX_EXP);
-    fastnumbers_FN_MIN_EXP = PyLong_FromLong(FN_MIN_EXP);
-    Py_INCREF(fastnumbers__version__);
-    Py_INCREF(fastnumbers_FN_MAX_INT_LEN);
-    Py_INCREF(fastnumbers_FN_DBL_DIG);
-    Py_INCREF(fastnumbers_FN_MAX_EXP);
-    Py_INCREF(fastnumbers_FN_MIN_EXP);
-    PyModule_AddObject(m, "__version__", fastnumbers__version__);
-    PyModule_AddObject(m, "max_int_len", fastnumbers_FN_MAX_INT_LEN);
-    PyModule_AddObject(m, "dig", fastnumbers_FN_DBL_DIG);
-    PyModule_AddObject(m, "max_exp", fastnumbers_FN_MAX_EXP);
-    PyModule_AddObject(m, "min_exp", fastnumbers_FN_MIN_EXP);
-
-    return m;
+    return PyModuleDef_Init(&moduledef);
 }
-
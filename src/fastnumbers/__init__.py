@@ -1,4 +1,6 @@
 from .fastnumbers import (
+    Converter,
+    InvalidNumberError,
     __version__,
     dig,
     fast_float,
@@ -11,14 +13,18 @@ from .fastnumbers import (
     isint,
     isintlike,
     isreal,
+    kernels,
     max_exp,
     max_int_len,
     min_exp,
     query_type,
     real,
+    scratch_allocations,
 )
 
 __all__ = [
+    "Converter",
+    "InvalidNumberError",
     "__version__",
     "dig",
     "fast_float",
@@ -31,9 +37,11 @@ __all__ = [
     "isint",
     "isintlike",
     "isreal",
+    "kernels",
     "max_exp",
     "max_int_len",
     "min_exp",
     "query_type",
     "real",
+    "scratch_allocations",
 ]
@@ -1,13 +1,29 @@
 from builtins import float as pyfloat, int as pyint
-from typing import Any, Callable, Optional, Sequence, Type, TypeVar, Union, overload
+from typing import (
+    Any,
+    Callable,
+    Iterable,
+    List,
+    Optional,
+    Sequence,
+    Type,
+    TypeVar,
+    Union,
+    overload,
+)
 
-from typing_extensions import Protocol
+from typing_extensions import Literal, Protocol
 
 __version__: str
 max_int_len: pyint
 dig: pyint
 max_exp: pyint
 min_exp: pyint
+kernels: str
+
+class InvalidNumberError(ValueError):
+    input: Any
+    base: Optional[pyint]
 
 class HasIndex(Protocol):
     def __index__(self) -> pyint: ...
@@ -35,6 +51,28 @@ Default = TypeVar("Default")
 Inf = TypeVar("Inf")
 Nan = TypeVar("Nan")
 TransformType = TypeVar("TransformType")
+Precision = Literal["exact", "fast"]
+ConverterKind = Literal["real", "float", "int", "forceint"]
+
+class Converter:
+    kind: ConverterKind
+    def __init__(
+        self,
+        kind: ConverterKind,
+        *,
+        default: Any = ...,
+        raise_on_invalid: bool = False,
+        on_fail: Optional[Callable[[Any], Any]] = None,
+        inf: Any = ...,
+        nan: Any = ...,
+        coerce: bool = True,
+        allow_underscores: bool = True,
+        base: Union[pyint, HasIndex] = 10,
+        precision: Precision = "exact",
+        trusted: bool = False,
+    ) -> None: ...
+    def __call__(self, x: InputType) -> Any: ...
+    def map(self, values: Iterable[InputType]) -> List[Any]: ...
 
 # Fast real
 @overload
@@ -44,6 +82,8 @@ def fast_real(
     raise_on_invalid: bool = False,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -53,6 +93,8 @@ def fast_real(
     inf: Inf,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Inf, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -62,6 +104,8 @@ def fast_real(
     nan: Nan,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -72,6 +116,8 @@ def fast_real(
     nan: Nan,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Inf, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -81,6 +127,8 @@ def fast_real(
     raise_on_invalid: bool = False,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -91,6 +139,8 @@ def fast_real(
     coerce: bool = True,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Inf, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -101,6 +151,8 @@ def fast_real(
     coerce: bool = True,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -112,6 +164,8 @@ def fast_real(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Inf, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -121,6 +175,8 @@ def fast_real(
     on_fail: Callable[[FastInputType], TransformType],
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -131,6 +187,8 @@ def fast_real(
     coerce: bool = True,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Inf, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -141,6 +199,8 @@ def fast_real(
     coerce: bool = True,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -152,6 +212,8 @@ def fast_real(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Inf, Nan, pyint, pyfloat]: ...
 @overload
 def fast_real(
@@ -160,6 +222,8 @@ def fast_real(
     raise_on_invalid: bool = False,
     coerce: bool = True,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, pyint, pyfloat]: ...
 @overload
@@ -170,6 +234,8 @@ def fast_real(
     coerce: bool = True,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Inf, pyint, pyfloat]: ...
 @overload
@@ -180,6 +246,8 @@ def fast_real(
     coerce: bool = True,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Nan, pyint, pyfloat]: ...
 @overload
@@ -191,6 +259,8 @@ def fast_real(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Inf, Nan, pyint, pyfloat]: ...
 
@@ -201,6 +271,8 @@ def fast_float(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, pyfloat]: ...
 @overload
 def fast_float(
@@ -209,6 +281,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Inf, pyfloat]: ...
 @overload
 def fast_float(
@@ -217,6 +291,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -226,6 +302,8 @@ def fast_float(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[FastInputType, Inf, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -234,6 +312,8 @@ def fast_float(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, pyfloat]: ...
 @overload
 def fast_float(
@@ -243,6 +323,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Inf, pyfloat]: ...
 @overload
 def fast_float(
@@ -252,6 +334,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -262,6 +346,8 @@ def fast_float(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[Default, Inf, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -270,6 +356,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     on_fail: Callable[[FastInputType], TransformType],
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, pyfloat]: ...
 @overload
 def fast_float(
@@ -279,6 +367,8 @@ def fast_float(
     on_fail: Callable[[FastInputType], TransformType],
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Inf, pyfloat]: ...
 @overload
 def fast_float(
@@ -288,6 +378,8 @@ def fast_float(
     on_fail: Callable[[FastInputType], TransformType],
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -298,6 +390,8 @@ def fast_float(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
 ) -> Union[TransformType, Inf, Nan, pyfloat]: ...
 @overload
 def fast_float(
@@ -305,6 +399,8 @@ def fast_float(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, pyfloat]: ...
 @overload
@@ -314,6 +410,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     inf: Inf,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Inf, pyfloat]: ...
 @overload
@@ -323,6 +421,8 @@ def fast_float(
     raise_on_invalid: bool = False,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Nan, pyfloat]: ...
 @overload
@@ -333,6 +433,8 @@ def fast_float(
     inf: Inf,
     nan: Nan,
     allow_underscores: bool = True,
+    precision: Precision = "exact",
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, Inf, Nan, pyfloat]: ...
 
@@ -343,6 +445,7 @@ def fast_int(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[FastInputType, pyint]: ...
 @overload
 def fast_int(
@@ -351,6 +454,7 @@ def fast_int(
     raise_on_invalid: bool = False,
     base: Union[pyint, HasIndex],
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[FastInputType, pyint]: ...
 @overload
 def fast_int(
@@ -359,6 +463,7 @@ def fast_int(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[Default, pyint]: ...
 @overload
 def fast_int(
@@ -368,6 +473,7 @@ def fast_int(
     raise_on_invalid: bool = False,
     base: Union[pyint, HasIndex],
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[Default, pyint]: ...
 @overload
 def fast_int(
@@ -376,6 +482,7 @@ def fast_int(
     raise_on_invalid: bool = False,
     on_fail: Callable[[FastInputType], TransformType],
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[TransformType, pyint]: ...
 @overload
 def fast_int(
@@ -385,6 +492,7 @@ def fast_int(
     on_fail: Callable[[FastInputType], TransformType],
     base: Union[pyint, HasIndex],
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[TransformType, pyint]: ...
 @overload
 def fast_int(
@@ -392,6 +500,7 @@ def fast_int(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, pyint]: ...
 @overload
@@ -401,6 +510,7 @@ def fast_int(
     raise_on_invalid: bool = False,
     base: Union[pyint, HasIndex],
     allow_underscores: bool = True,
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, pyint]: ...
 
@@ -411,6 +521,7 @@ def fast_forceint(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[FastInputType, pyint]: ...
 @overload
 def fast_forceint(
@@ -419,6 +530,7 @@ def fast_forceint(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[Default, pyint]: ...
 @overload
 def fast_forceint(
@@ -427,6 +539,7 @@ def fast_forceint(
     raise_on_invalid: bool = False,
     on_fail: Callable[[FastInputType], TransformType],
     allow_underscores: bool = True,
+    trusted: bool = False,
 ) -> Union[TransformType, pyint]: ...
 @overload
 def fast_forceint(
@@ -434,6 +547,7 @@ def fast_forceint(
     *,
     raise_on_invalid: bool = False,
     allow_underscores: bool = True,
+    trusted: bool = False,
     key: Callable[[FastInputType], TransformType],
 ) -> Union[TransformType, pyint]: ...
 
@@ -501,3 +615,6 @@ def int(x: InputType = 0) -> pyint: ...
 def int(x: InputType, base: Union[pyint, HasIndex]) -> pyint: ...
 def float(x: InputType = 0.0) -> pyfloat: ...
 def real(x: InputType = 0.0, *, coerce: bool = True) -> Union[pyint, pyfloat]: ...
+
+# Debugging
+def scratch_allocations() -> pyint: ...
@@ -0,0 +1,627 @@
+/* Vectorized character classification.
+ *
+ * Each class is found with one or two byte-wise comparisons per 16
+ * (or 32) characters, and the results are collapsed into bit masks so
+ * that the grammar of a short number can be checked with a handful of
+ * integer operations instead of a loop over the characters.
+ *
+ * There is a variant of the kernels for each instruction set, compiled
+ * with per-function target attributes, and the best one that the CPU
+ * supports is chosen when the module is imported.
+ */
+#include <Python.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fastnumbers/fn_inline.h"
+#include "fastnumbers/kernels.h"
+#include "fastnumbers/parsing.h"
+#include "fastnumbers/pstdint.h"
+
+#if FN_HAVE_VECTOR_KERNELS
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <windows.h>
+#endif
+
+/* Compile a function for an instruction set beyond the baseline.
+ * MSVC allows any intrinsic in any function, so needs nothing.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define FN_TARGET_SSE2 __attribute__((target("sse2")))
+#define FN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FN_TARGET_SSE2
+#define FN_TARGET_AVX2
+#endif
+
+/* The character classes of a string as bit masks, where bit i
+ * describes the character at index i.
+ */
+typedef struct CharClasses {
+    uint32_t all;     /* Every character in the string. */
+    uint32_t digits;  /* '0' through '9'. */
+    uint32_t zeros;   /* '0'. */
+    uint32_t dots;    /* '.'. */
+    uint32_t exps;    /* 'e' or 'E'. */
+    uint32_t signs;   /* '+' or '-'. */
+} CharClasses;
+
+/* Forward declarations. */
+FN_INLINE(int)
+classes_contain_intlike_float(const char *str, const char *end,
+                              const CharClasses *classes);
+FN_INLINE(bool)
+is_float_grammar(const CharClasses *classes);
+FN_INLINE(void)
+mask_classes(CharClasses *classes, const Py_ssize_t len);
+FN_INLINE(int)
+lowest_bit_index(const uint32_t x);
+FN_INLINE(int)
+highest_bit_index(const uint32_t x);
+FN_INLINE(int)
+bit_length(const uint32_t x);
+
+/* Reads never cross a boundary of this size, the smallest page size
+ * on any supported platform.
+ */
+#define FN_PAGE_SIZE 4096
+
+/* Is it safe to read n bytes from str, even if the string is shorter?
+ * Reading past the end is harmless as long as the read does not cross
+ * into another (possibly unmapped) page, and the extra characters are
+ * masked off afterwards.
+ */
+#define can_read_past_end(str, n) \
+    (((uintptr_t) (str) & (FN_PAGE_SIZE - 1)) <= FN_PAGE_SIZE - (n))
+
+/* A mask of the lowest n bits. */
+#define bits_below(n) ((n) >= 32 ? UINT32_MAX : (UINT32_C(1) << (n)) - 1)
+
+/* Define the classify functions and the Kernels of a variant, given
+ * its classify_characters_<variant> function and the variant of the
+ * narrowing function that it uses.
+ */
+#define define_kernels(variant, target, narrow_variant) \
+    target static int \
+    classify_int_##variant(const char *str, const char *end) \
+    { \
+        CharClasses classes; \
+        if (!classify_characters_##variant(str, end, &classes)) { \
+            return FN_UNCLASSIFIED; \
+        } \
+        return classes.digits == classes.all; \
+    } \
+    target static int \
+    classify_number_##variant(const char *str, const char *end, \
+                              const bool intlike) \
+    { \
+        CharClasses classes; \
+        /* Ints are the common case, and only need the digits. */ \
+        const int is_int = classify_int_##variant(str, end); \
+        if (is_int != 0) { \
+            return is_int == 1 ? FN_INT : FN_UNCLASSIFIED; \
+        } \
+        if (!classify_characters_##variant(str, end, &classes)) { \
+            return FN_UNCLASSIFIED; \
+        } \
+        if (!is_float_grammar(&classes)) { \
+            return FN_NOT_NUMBER; \
+        } \
+        return intlike && classes_contain_intlike_float(str, end, &classes) \
+               ? FN_INTLIKE_FLOAT : FN_FLOAT; \
+    } \
+    static const Kernels variant##_kernels = { \
+        #variant, \
+        classify_int_##variant, \
+        classify_number_##variant, \
+        narrow_ucs2_##narrow_variant \
+    }
+
+
+/* The scalar variant leaves everything to the scalar parsers. */
+static int
+classify_int_scalar(const char *str, const char *end)
+{
+    (void) str;
+    (void) end;
+    return FN_UNCLASSIFIED;
+}
+
+static int
+classify_number_scalar(const char *str, const char *end, const bool intlike)
+{
+    (void) str;
+    (void) end;
+    (void) intlike;
+    return FN_UNCLASSIFIED;
+}
+
+/* Narrow one code unit at a time, remembering if any was not ASCII. */
+static bool
+narrow_ucs2_scalar(const Py_UCS2 *src, const Py_ssize_t len, char *dst)
+{
+    register Py_ssize_t i;
+    register Py_UCS2 seen = 0;
+    for (i = 0; i < len; i++) {
+        seen |= src[i];
+        dst[i] = (char) src[i];
+    }
+    return seen < 128;
+}
+
+static const Kernels scalar_kernels = {
+    "scalar", classify_int_scalar, classify_number_scalar,
+    narrow_ucs2_scalar
+};
+
+
+#if FN_HAVE_VECTOR_KERNELS
+
+/* Classify 16 characters, one bit per character in each mask. */
+FN_TARGET_SSE2 FN_INLINE(void)
+classify_sixteen(const __m128i chars, uint32_t *digits, uint32_t *zeros,
+                 uint32_t *dots, uint32_t *exps, uint32_t *signs)
+{
+    /* Signed comparisons - non-ASCII bytes are negative, so are never
+     * mistaken for digits.
+     */
+    const __m128i is_digit = _mm_and_si128(
+        _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1))
+    );
+    const __m128i is_exp = _mm_cmpeq_epi8(
+        _mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('e')
+    );
+    const __m128i is_sign = _mm_or_si128(
+        _mm_cmpeq_epi8(chars, _mm_set1_epi8('+')),
+        _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'))
+    );
+    *digits = (uint32_t) _mm_movemask_epi8(is_digit);
+    *zeros = (uint32_t) _mm_movemask_epi8(
+                 _mm_cmpeq_epi8(chars, _mm_set1_epi8('0'))
+             );
+    *dots = (uint32_t) _mm_movemask_epi8(
+                _mm_cmpeq_epi8(chars, _mm_set1_epi8('.'))
+            );
+    *exps = (uint32_t) _mm_movemask_epi8(is_exp);
+    *signs = (uint32_t) _mm_movemask_epi8(is_sign);
+}
+
+
+/* Load the 16 characters starting at str, of which only the first
+ * len are part of the string.
+ */
+FN_TARGET_SSE2 FN_INLINE(__m128i)
+load_sixteen(const char *str, const Py_ssize_t len)
+{
+    char buffer[16];
+    if (len >= 16 || can_read_past_end(str, 16)) {
+        return _mm_loadu_si128((const __m128i *) str);
+    }
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, str, (size_t) len);
+    return _mm_loadu_si128((const __m128i *) buffer);
+}
+
+
+/* Fill in the character classes of a string sixteen characters at a
+ * time, returning false if the string is too long (or empty).
+ */
+FN_TARGET_SSE2 FN_INLINE(bool)
+classify_characters_sse2(const char *str, const char *end,
+                         CharClasses *classes)
+{
+    const Py_ssize_t len = end - str;
+    uint32_t digits, zeros, dots, exps, signs;
+
+    if (len <= 0 || len > FN_MAX_CLASSIFY_LEN) {
+        return false;
+    }
+
+    classify_sixteen(load_sixteen(str, len),
+                     &classes->digits, &classes->zeros, &classes->dots,
+                     &classes->exps, &classes->signs);
+    if (len > 16) {
+        classify_sixteen(load_sixteen(str + 16, len - 16),
+                         &digits, &zeros, &dots, &exps, &signs);
+        classes->digits |= digits << 16;
+        classes->zeros |= zeros << 16;
+        classes->dots |= dots << 16;
+        classes->exps |= exps << 16;
+        classes->signs |= signs << 16;
+    }
+    mask_classes(classes, len);
+    return true;
+}
+
+
+/* Fill in the character classes of a string with one 32-character
+ * register, returning false if the string is too long (or empty).
+ */
+FN_TARGET_AVX2 FN_INLINE(bool)
+classify_characters_avx2(const char *str, const char *end,
+                         CharClasses *classes)
+{
+    const Py_ssize_t len = end - str;
+    char buffer[32];
+    __m256i chars;
+
+    if (len <= 0 || len > FN_MAX_CLASSIFY_LEN) {
+        return false;
+    }
+    if (len == 32 || can_read_past_end(str, 32)) {
+        chars = _mm256_loadu_si256((const __m256i *) str);
+    }
+    else {
+        memset(buffer, 0, sizeof(buffer));
+        memcpy(buffer, str, (size_t) len);
+        chars = _mm256_loadu_si256((const __m256i *) buffer);
+    }
+
+    /* As for SSE2, which has the same comparisons. */
+    classes->digits = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars)
+    ));
+    classes->zeros = (uint32_t) _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('0'))
+    );
+    classes->dots = (uint32_t) _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('.'))
+    );
+    classes->exps = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_or_si256(chars, _mm256_set1_epi8(0x20)),
+        _mm256_set1_epi8('e')
+    ));
+    classes->signs = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('+')),
+        _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'))
+    ));
+    mask_classes(classes, len);
+    return true;
+}
+
+
+/* Narrow sixteen code units at a time with saturating packs, so that
+ * anything that is not ASCII becomes a byte with the high bit set.
+ * (UCS4 code units are at most 0x10FFFF, so are positive as int32.)
+ * AVX2 packs within each 128-bit lane, so would gain little here.
+ */
+/* Are all bits of the vector zero? */
+FN_TARGET_SSE2 FN_INLINE(bool)
+is_zero_sse2(const __m128i bits)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128()))
+           == 0xFFFF;
+}
+
+
+FN_TARGET_SSE2 static bool
+narrow_ucs2_sse2(const Py_UCS2 *src, const Py_ssize_t len, char *dst)
+{
+    register Py_ssize_t i = 0;
+    const __m128i high = _mm_set1_epi16((short) 0xFF80);
+    for (; i + 16 <= len; i += 16) {
+        const __m128i lo = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i hi = _mm_loadu_si128((const __m128i *) (src + i + 8));
+
+        /* The pack saturates as signed, so the high bits are
+         * checked before packing rather than after.
+         */
+        if (!is_zero_sse2(_mm_and_si128(_mm_or_si128(lo, hi), high))) {
+            return false;
+        }
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+    return narrow_ucs2_scalar(src + i, len - i, dst + i);
+}
+
+
+define_kernels(sse2, FN_TARGET_SSE2, sse2);
+define_kernels(avx2, FN_TARGET_AVX2, sse2);
+
+
+/* CPU feature detection. The GCC/Clang builtins also check that the
+ * operating system saves the AVX registers.
+ */
+static bool
+cpu_supports_sse2(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#endif
+}
+
+
+static bool
+cpu_supports_avx2(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    /* AVX (bit 28) and OSXSAVE (bit 27), with the XMM and YMM state
+     * enabled by the operating system.
+     */
+    __cpuid(info, 1);
+    if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif /* FN_HAVE_VECTOR_KERNELS */
+
+
+static bool
+cpu_supports_scalar(void)
+{
+    return true;
+}
+
+
+/* All variants, from least to most preferred. */
+static const struct {
+    const Kernels *kernels;
+    bool (*supported)(void);
+} variants[] = {
+    {&scalar_kernels, cpu_supports_scalar},
+#if FN_HAVE_VECTOR_KERNELS
+    {&sse2_kernels, cpu_supports_sse2},
+    {&avx2_kernels, cpu_supports_avx2},
+#endif
+};
+#define FN_NUM_VARIANTS (sizeof(variants) / sizeof(variants[0]))
+
+const Kernels *kernels = NULL;
+
+
+/* Atomically store chosen in kernels unless a variant has already
+ * been chosen, and return the variant in use. Compilers without
+ * atomics only get here under a single GIL (see scratch.h), which
+ * is enough to make the check and the store one step.
+ */
+static const Kernels *
+use_kernels_once(const Kernels *chosen)
+{
+    const Kernels *previous;
+#if defined(_MSC_VER)
+    previous = (const Kernels *) InterlockedCompareExchangePointer(
+                   (PVOID volatile *) &kernels, (PVOID) chosen, NULL
+               );
+#elif defined(__GNUC__) || defined(__clang__)
+    previous = __sync_val_compare_and_swap(&kernels, NULL, chosen);
+#else
+    previous = kernels;
+    if (previous == NULL) {
+        kernels = chosen;
+    }
+#endif
+    return previous != NULL ? previous : chosen;
+}
+
+
+/* Choose the variant for the process. Only the first import (in any
+ * interpreter) chooses; later ones keep what it chose, whatever the
+ * environment variable says by then, as other threads may be reading
+ * it without a lock.
+ */
+int
+select_kernels(void)
+{
+    const char *requested = NULL;
+    const Kernels *chosen = &scalar_kernels;
+    register size_t i;
+
+    /* An atomic read of whether the variant has been chosen. */
+    if (use_kernels_once(NULL) != NULL) {
+        return 0;
+    }
+    requested = getenv(FN_KERNELS_ENV);
+
+    /* The best supported variant. */
+    if (requested == NULL || requested[0] == '\0') {
+        for (i = 0; i < FN_NUM_VARIANTS; i++) {
+            if (variants[i].supported()) {
+                chosen = variants[i].kernels;
+            }
+        }
+        use_kernels_once(chosen);
+        return 0;
+    }
+
+    /* A specific variant. Never use one the CPU cannot run. */
+    for (i = 0; i < FN_NUM_VARIANTS; i++) {
+        if (strcmp(requested, variants[i].kernels->name) == 0) {
+            if (!variants[i].supported()) {
+                PyErr_Format(PyExc_RuntimeError,
+                             "%s=%s is not supported by this CPU",
+                             FN_KERNELS_ENV, requested);
+                return -1;
+            }
+            use_kernels_once(variants[i].kernels);
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "unknown %s variant '%s'",
+                 FN_KERNELS_ENV, requested);
+    return -1;
+}
+
+
+/* Given the character classes of a float, implement the same
+ * criteria for an int-like float as tokenize_number.
+ */
+FN_INLINE(int)
+classes_contain_intlike_float(const char *str, const char *end,
+                              const CharClasses *classes)
+{
+    register bool exp_negative = false;
+    register int64_t expon = 0;
+    int len, exp_start, int_end, dec_start, dec_end;
+    uint16_t dec_length, int_trailing_zeros, dec_trailing_zeros;
+    uint32_t nonzeros;
+
+    /* Locate the integer and decimal parts. */
+    len = (int) (end - str);
+    exp_start = classes->exps ? lowest_bit_index(classes->exps) : len;
+    int_end = classes->dots ? lowest_bit_index(classes->dots) : exp_start;
+    dec_start = classes->dots ? int_end + 1 : exp_start;
+    dec_end = exp_start;
+    dec_length = (uint16_t) (dec_end - dec_start);
+
+    /* Both parts consist only of digits, so the trailing zeros are
+     * the digits after the last non-zero digit of each part.
+     */
+    nonzeros = classes->digits & ~classes->zeros;
+    int_trailing_zeros = (uint16_t) (
+        int_end - bit_length(nonzeros & bits_below(int_end))
+    );
+    dec_trailing_zeros = (uint16_t) (
+        dec_end - Py_MAX(bit_length(nonzeros & bits_below(dec_end)),
+                         dec_start)
+    );
+
+    /* Parse the exponent. It usually has few digits, so add them up
+     * without a loop, which would mispredict as the length varies.
+     * Reading a non-existent digit is replaced by re-reading the last.
+     */
+    if (classes->exps) {
+        const int ndigits = len - exp_start - 1 - (classes->signs != 0);
+        exp_negative = str[exp_start + 1] == '-';
+        if (ndigits <= 4) {
+            expon = (int64_t) (
+                (end[-1] - '0') +
+                (ndigits > 1) * 10 * (end[ndigits > 1 ? -2 : -1] - '0') +
+                (ndigits > 2) * 100 * (end[ndigits > 2 ? -3 : -1] - '0') +
+                (ndigits > 3) * 1000 * (end[ndigits > 3 ? -4 : -1] - '0')
+            );
+        }
+        else {
+            for (str = end - ndigits; str != end; str += 1) {
+                if (expon < FN_MAX_EXPON) {
+                    expon *= 10;
+                    expon += (int64_t) (*str - '0');
+                }
+            }
+        }
+    }
+
+    /* Evaluate the criteria for both exponent signs to avoid a branch. */
+    {
+        const bool negative_ok = (expon <= int_trailing_zeros) &
+                                 (dec_length == dec_trailing_zeros);
+        const bool positive_ok = expon >= (dec_length - dec_trailing_zeros);
+        return (exp_negative & negative_ok) | (!exp_negative & positive_ok);
+    }
+}
+
+
+/* Check the grammar of a float (without infinity or NaN), i.e.
+ * digits, then optionally a '.' and more digits, then optionally an
+ * exponent of 'e' or 'E', an optional sign and at least one digit.
+ * There must be at least one digit before the exponent.
+ */
+FN_INLINE(bool)
+is_float_grammar(const CharClasses *classes)
+{
+    const uint32_t digits = classes->digits;
+    const uint32_t dots = classes->dots;
+    const uint32_t exps = classes->exps;
+    const uint32_t signs = classes->signs;
+    const uint32_t last = classes->all & ~(classes->all >> 1);
+
+    /* Only these characters are allowed. Text fails here. */
+    if ((digits | dots | exps | signs) != classes->all) {
+        return false;
+    }
+
+    /* At most one of each non-digit. Signs can only follow the
+     * exponent character, the decimal point cannot come after it,
+     * there must be a digit before it, and the string must end in a
+     * digit if there is one. The conditions are combined without
+     * branches because the presence of a sign or exponent is
+     * unpredictable.
+     */
+    return ((dots & (dots - 1)) == 0) &
+           ((exps & (exps - 1)) == 0) &
+           ((signs == 0) | (signs == exps << 1)) &
+           ((exps == 0) | (dots < exps)) &
+           ((digits & (exps - 1)) != 0) &
+           ((exps == 0) | ((digits & last) != 0));
+}
+
+
+/* Ignore anything loaded from beyond the end of a string. */
+FN_INLINE(void)
+mask_classes(CharClasses *classes, const Py_ssize_t len)
+{
+    classes->all = bits_below(len);
+    classes->digits &= classes->all;
+    classes->zeros &= classes->all;
+    classes->dots &= classes->all;
+    classes->exps &= classes->all;
+    classes->signs &= classes->all;
+}
+
+
+FN_INLINE(int)
+lowest_bit_index(const uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (int) index;
+#else
+    register int index = 0;
+    while (!(x & (UINT32_C(1) << index))) {
+        index += 1;
+    }
+    return index;
+#endif
+}
+
+
+FN_INLINE(int)
+highest_bit_index(const uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - __builtin_clz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return (int) index;
+#else
+    register int index = 31;
+    while (!(x & (UINT32_C(1) << index))) {
+        index -= 1;
+    }
+    return index;
+#endif
+}
+
+
+/* The number of bits needed to hold x, i.e. one more than the index
+ * of the highest set bit, or zero if there are none.
+ */
+FN_INLINE(int)
+bit_length(const uint32_t x)
+{
+    return x ? highest_bit_index(x) + 1 : 0;
+}
@@ -18,6 +18,27 @@
 #define RETURN_CORRECT_RESULT(ret, opt) \
     ((ret) ? (ret) : Options_Return_Correct_Result_On_Error(opt))
 
+/* Strings are converted in batches of up to this many inputs. */
+#define FN_BATCH_LEN 1024
+
+/* A batch with fewer strings than this is parsed holding the GIL,
+ * since releasing it would cost more than it could save.
+ */
+#define FN_BATCH_MIN_RELEASE 64
+
+/* A string in a batch, and what parsing it found. */
+typedef struct BatchItem {
+    const char *str;  /* NULL unless it is parsed in the batch. */
+    const char *end;
+    FnResult result;
+} BatchItem;
+
+
+/* Forward declarations */
+static void
+parse_batch(BatchItem *batch, const Py_ssize_t len, const PyNumberType type,
+            const Options *options);
+
 
 /* Attempt to convert an arbitrary PyObject to a PyNumber. */
 PyObject *
@@ -41,11 +62,10 @@ PyObject_to_PyNumber(PyObject *obj, const PyNumberType type,
     }
 
     /* Assume a string. */
-    pyresult = PyString_to_PyNumber(obj, type, options);
-    if (errno == ENOMEM) {
+    switch (PyString_to_PyNumber(obj, type, options, &pyresult)) {
+    case -1:
         return NULL;  /* ALWAYS raise on out-of-memory errors. */
-    }
-    if (pyresult != Py_None) {
+    case 1:
         return RETURN_CORRECT_RESULT(pyresult, options);
     }
 
@@ -92,6 +112,7 @@ PyObject_is_number(PyObject *obj, const PyNumberType type,
                    const Options *options)
 {
     PyObject *pyresult = NULL;
+    bool result = false;
 
     /* Already a number? Simple checks will work. */
     if (PyNumber_Check(obj)) {
@@ -109,12 +130,11 @@ PyObject_is_number(PyObject *obj, const PyNumberType type,
     }
 
     /* Assume a string. */
-    pyresult = PyString_is_number(obj, type, options);
-    if (pyresult == NULL || errno == ENOMEM) {
+    switch (PyString_is_number(obj, type, options, &result)) {
+    case -1:
         return NULL; /* ALWAYS raise on out-of-memory errors. */
-    }
-    else if (pyresult != Py_None) {
-        return pyresult;
+    case 1:
+        return PyBool_FromLong(result);
     }
 
     /* Assume unicode. */
@@ -148,11 +168,10 @@ PyObject_contains_type(PyObject *obj, const Options *options)
     }
 
     /* Assume a string. */
-    pyresult = PyString_contains_type(obj, options);
-    if (pyresult == NULL || errno == ENOMEM) {
+    switch (PyString_contains_type(obj, options, &pyresult)) {
+    case -1:
         return NULL; /* ALWAYS raise on out-of-memory errors. */
-    }
-    else if (pyresult != Py_None) {
+    case 1:
         return pyresult;
     }
 
@@ -165,3 +184,100 @@ PyObject_contains_type(PyObject *obj, const Options *options)
     /* If we got here, the type was invalid. */
     return PyObject_Type(obj);
 }
+
+
+/* Convert each item of a tuple as PyObject_to_PyNumber would, with
+ * the input-dependent options set from default_value and raise, into
+ * a new list. The items are taken FN_BATCH_LEN at a time: the strings
+ * among them that PyString_stable_chars accepts are parsed all at once
+ * (without the GIL if there are enough of them), and only then are the
+ * Python objects built, in order. Anything else is converted in its
+ * turn.
+ */
+PyObject *
+PyTuple_to_PyNumbers(PyObject *items, const PyNumberType type,
+                     const Options *options, PyObject *default_value,
+                     const bool raise)
+{
+    const Py_ssize_t n = PyTuple_GET_SIZE(items);
+    PyObject *results = PyList_New(n);
+    BatchItem *batch = NULL;
+    Py_ssize_t start, i;
+
+    if (results == NULL) {
+        return NULL;
+    }
+    if ((batch = PyMem_New(BatchItem, FN_BATCH_LEN)) == NULL) {
+        Py_DECREF(results);
+        return PyErr_NoMemory();
+    }
+
+    for (start = 0; start < n; start += FN_BATCH_LEN) {
+        const Py_ssize_t len = n - start < FN_BATCH_LEN
+                               ? n - start : FN_BATCH_LEN;
+        Py_ssize_t nstrings = 0;
+
+        for (i = 0; i < len; i++) {
+            batch[i].str = PyString_stable_chars(
+                               PyTuple_GET_ITEM(items, start + i), type,
+                               options, &batch[i].end
+                           );
+            nstrings += batch[i].str != NULL;
+        }
+
+        /* The tuple holds on to the strings, and neither they nor
+         * the options can change, so they can be read without the GIL.
+         */
+        if (nstrings >= FN_BATCH_MIN_RELEASE) {
+            Py_BEGIN_ALLOW_THREADS
+            parse_batch(batch, len, type, options);
+            Py_END_ALLOW_THREADS
+        }
+        else {
+            parse_batch(batch, len, type, options);
+        }
+
+        for (i = 0; i < len; i++) {
+            PyObject *input = PyTuple_GET_ITEM(items, start + i);
+            PyObject *number = NULL;
+            Options opts = *options;
+            Options_Set_Return_Value(opts, input, default_value, raise);
+            if (batch[i].str == NULL) {
+                number = PyObject_to_PyNumber(input, type, &opts);
+            }
+            else {
+                number = PyString_result_to_PyNumber(
+                             &batch[i].result, batch[i].str, batch[i].end,
+                             type, &opts
+                         );
+                if (number == NULL && !PyErr_Occurred()) {
+                    number = RETURN_CORRECT_RESULT(NULL, &opts);
+                }
+            }
+            if (number == NULL) {
+                PyMem_Free(batch);
+                Py_DECREF(results);
+                return NULL;
+            }
+            PyList_SET_ITEM(results, start + i, number);
+        }
+    }
+
+    PyMem_Free(batch);
+    return results;
+}
+
+
+/* Parse the strings of a batch. This uses no Python objects. */
+static void
+parse_batch(BatchItem *batch, const Py_ssize_t len, const PyNumberType type,
+            const Options *options)
+{
+    register Py_ssize_t i;
+    for (i = 0; i < len; i++) {
+        if (batch[i].str != NULL) {
+            batch[i].result = string_to_result(batch[i].str, batch[i].end,
+                                               type, options);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/* Reading the options given as Python objects.
+ */
+#include <Python.h>
+#include <limits.h>
+#include "fastnumbers/options.h"
+
+
+/* Function to handle the conversion of base to integers.
+ * 0 is success, 1 is failure.
+ */
+int
+assess_integer_base_input(PyObject *pybase, int *base)
+{
+    Py_ssize_t longbase = 0;
+
+    /* Default to INT_MIN.
+     */
+    if (pybase == NULL) {
+        *base = INT_MIN;
+        return 0;
+    }
+
+    /* Convert to int and check for overflow.
+     */
+    longbase = PyNumber_AsSsize_t(pybase, NULL);
+    if (longbase == -1 && PyErr_Occurred()) {
+        return 1;
+    }
+
+    /* Ensure valid integer in valid range.
+     */
+    if ((longbase != 0 && longbase < 2) || longbase > 36) {
+        PyErr_SetString(PyExc_ValueError,
+                        "int() base must be >= 2 and <= 36");
+        return 1;
+    }
+    *base = (int) longbase;
+    return 0;
+}
+
+
+/* Function to handle the conversion of precision to a flag.
+ * 0 is success, 1 is failure.
+ */
+int
+assess_precision_input(PyObject *pyprecision, bool *exact)
+{
+    /* Default to correctly rounded.
+     */
+    if (pyprecision == NULL) {
+        *exact = true;
+        return 0;
+    }
+
+    if (PyUnicode_Check(pyprecision)) {
+        if (PyUnicode_CompareWithASCIIString(pyprecision, "exact") == 0) {
+            *exact = true;
+            return 0;
+        }
+        if (PyUnicode_CompareWithASCIIString(pyprecision, "fast") == 0) {
+            *exact = false;
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError,
+                 "precision must be 'exact' or 'fast', not %R", pyprecision);
+    return 1;
+}
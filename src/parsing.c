@@ -6,23 +6,60 @@
  */
 #include <Python.h>
 #include <string.h>
+#include "fastnumbers/kernels.h"
 #include "fastnumbers/parsing.h"
+#include "fastnumbers/tables.h"
 #include "fastnumbers/pstdint.h"
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 /******************/
 /****** NOTE ******/
 /******************/
 /* All functions in this file assume whitespace has been trimmed
- * from both sides of the string, and that the sign has been removed.
+ * from both sides of the string, and that the sign has been removed
+ * (except for tokenize_number, which records the sign itself).
+ * Strings need not be terminated - nothing at or past end is read,
+ * so a slice of a larger buffer can be parsed in place.
  */
 
 /* Forward declarations. */
-static uint16_t
+static void
+scan_number(register const char *str, register const char *end,
+            NumberToken *token, const TokenDetail detail,
+            const bool allow_underscores);
+static Py_ssize_t
 number_trailing_zeros(register const char *start, register const char *end);
 static int
 detect_base(register const char *str, register const char *end);
-static long double
-power_of_ten_scaling_factor(const int expon);
+static const char *
+skip_base_prefix(register const char *str, register const char *end,
+                 const int base, const bool allow_underscores);
+static bool
+has_eight_digits(register const char *str, register const char *end);
+static uint32_t
+eight_digits(register const char *str);
+static uint64_t
+parse_digits(register const char **str, register const char *end);
+static void
+full_multiplication(const uint64_t a, const uint64_t b,
+                    uint64_t *high, uint64_t *low);
+static uint16_t
+append_eight_digits(uint64_t *mantissa, uint16_t *ndigits, bool *truncated,
+                    const uint32_t value);
+static double
+decimal_to_double(const int64_t q, const uint64_t w, const bool truncated,
+                  bool *ambiguous);
+static double
+long_decimal_to_double(const int64_t q, const uint64_t w,
+                       const char *int_start, const char *int_end,
+                       const char *frac_start, const char *frac_end);
+static FnResult
+invalid_result(void);
+static FnResult
+long_int_result(const char *start, const char *end, const Py_ssize_t ndigits);
 
 
 /* Local convenience macros.
@@ -30,272 +67,616 @@ power_of_ten_scaling_factor(const int expon);
  * The user can provide a "payload" of commands to execute for each
  * iteration of the parsing loop. It is recommended to put the payload
  * in a block.
+ *
+ * Runs of digits are first consumed eight at a time while at least
+ * eight remain, executing "eight_payload" (use eight_digits(str) to get
+ * their value), and then the remainder one at a time.
+ *
+ * If "underscores" is true, an underscore between two digits is
+ * skipped as in Python's grammar, and counted in "nunderscores".
  */
-#define parse_integer_macro(str, valid, payload) \
-    while (is_valid_digit(str)) { \
-        payload; \
-        (str) += 1; \
-        (valid) = true; \
-    }
+#define parse_integer_macro(str, end, valid, underscores, nunderscores, \
+                            eight_payload, payload) \
+    do { \
+        while (has_eight_digits(str, end)) { \
+            eight_payload; \
+            (str) += 8; \
+            (valid) = true; \
+        } \
+        while ((str) != (end) && is_valid_digit(str)) { \
+            payload; \
+            (str) += 1; \
+            (valid) = true; \
+        } \
+    } while ((underscores) && \
+             is_underscore_between_digits(str, end, valid, 10) && \
+             ((str) += 1, (nunderscores) += 1, true))
 
-#define parse_decimal_macro(str, valid, payload) \
-    if (*(str) == '.') { \
+#define parse_decimal_macro(str, end, valid, underscores, nunderscores, \
+                            eight_payload, payload) \
+    if ((str) != (end) && *(str) == '.') { \
         (str) += 1; \
-        parse_integer_macro(str, valid, payload); \
+        parse_integer_macro(str, end, valid, underscores, nunderscores, \
+                            eight_payload, payload); \
     }
 
-#define parse_exponent_macro(str, valid, negative_payload, payload) \
-    if ((*(str) == 'e' || *(str) == 'E') && (valid)) { \
+#define parse_exponent_macro(str, end, valid, underscores, \
+                             negative_payload, payload) \
+    if ((str) != (end) && (*(str) == 'e' || *(str) == 'E') && (valid)) { \
         (str) += 1; \
-        if (is_sign(str)) { \
+        if ((str) != (end) && is_sign(str)) { \
             if (*(str) == '-') { \
                 negative_payload; \
             } \
             (str) += 1; \
         } \
         (valid) = false; \
-        while (is_valid_digit(str)) { \
+        do { \
+            while ((str) != (end) && is_valid_digit(str)) { \
+                payload; \
+                (str) += 1; \
+                (valid) = true; \
+            } \
+        } while ((underscores) && \
+                 is_underscore_between_digits(str, end, valid, 10) && \
+                 ((str) += 1, true)); \
+    }
+
+/* Digits in an arbitrary base are consumed one at a time. */
+#define parse_based_integer_macro(str, end, base, valid, underscores, \
+                                  payload) \
+    while ((str) != (end)) { \
+        if (is_valid_digit_arbitrary_base(*(str), base)) { \
             payload; \
             (str) += 1; \
             (valid) = true; \
         } \
+        else if ((underscores) && \
+                 is_underscore_between_digits(str, end, valid, base)) { \
+            (str) += 1; \
+        } \
+        else { \
+            break; \
+        } \
     }
 
+/* Is str on an underscore between two digits? The character before
+ * str is only looked at once a digit has been consumed (i.e. valid).
+ */
+#define is_underscore_between_digits(str, end, valid, base) \
+    ((str) != (end) && *(str) == '_' && (valid) && \
+     is_valid_digit_arbitrary_base((str)[-1], base) && \
+     (str) + 1 != (end) && is_valid_digit_arbitrary_base((str)[1], base))
+
+/* Could the string hold an underscore that the kernels rejected? */
+#define may_have_underscores(str, end, underscores) \
+    ((underscores) && memchr(str, '_', (size_t) ((end) - (str))) != NULL)
+
 
 bool
 string_contains_int(register const char *str, register const char *end,
-                    int base)
+                    int base, const bool allow_underscores)
 {
     register bool valid = false;
+    Py_ssize_t nunderscores = 0;
 
     if (base == 0) {
         base = detect_base(str, end);
     }
 
-    /* If base 10, take fast route. */
+    /* If base 10, take fast route. Short strings are checked
+     * all at once if possible.
+     */
     if (base == 10) {
-        parse_integer_macro(str, valid, {});
+        const int classified = kernels->classify_int(str, end);
+        if (classified != FN_UNCLASSIFIED &&
+                (classified ||
+                 !may_have_underscores(str, end, allow_underscores))) {
+            return classified;
+        }
+        parse_integer_macro(str, end, valid, allow_underscores, nunderscores,
+                            {}, {});
         return valid && str == end;
     }
     else if (base == -1) {
         return false;
     }
     else {
-        const register Py_ssize_t len = end - str;
-
         /* Skip leading characters for non-base 10 ints. */
-        if (len > 1 && str[0] == '0' &&
-                ((base == 16 && (str[1] == 'x' || str[1] == 'X')) ||
-                 (base == 8  && (str[1] == 'o' || str[1] == 'O')) ||
-                 (base == 2  && (str[1] == 'b' || str[1] == 'B')))) {
-            str += 2;
-        }
+        str = skip_base_prefix(str, end, base, allow_underscores);
 
         /* The rest behaves as normal. */
-        while (is_valid_digit_arbitrary_base(*str, base)) {
-            str += 1;
-            valid = true;
-        }
+        parse_based_integer_macro(str, end, base, valid, allow_underscores,
+                                  {});
         return valid && str == end;
     }
 }
 
 
-bool
-string_contains_float(register const char *str,
-                      register const char *end,
-                      const bool allow_inf,
-                      const bool allow_nan)
+void
+tokenize_number(register const char *str, register const char *end,
+                NumberToken *token, const TokenDetail detail,
+                const bool allow_underscores)
 {
-    register bool valid = false;
-    const register Py_ssize_t len = end - str;
+    Py_ssize_t len;
+    int classified;
+
+    token->sign = consume_and_return_sign(str, end);
+    len = end - str;
+
+    /* If only the kind is needed, short strings are checked all
+     * at once if possible. Infinity and NaN are not numbers to
+     * the kernels, so only those need a second look.
+     */
+    classified = detail == FN_DETAIL_ALL
+                 ? FN_UNCLASSIFIED
+                 : kernels->classify_number(str, end,
+                                            detail == FN_DETAIL_KIND);
+    if (classified != FN_UNCLASSIFIED && classified != FN_NOT_NUMBER) {
+        token->kind = (NumberKind) classified;
+        return;
+    }
 
     /* NAN or INF */
     if (quick_detect_infinity(str, len)) {
-        return allow_inf;
+        token->kind = FN_INFINITY;
+        return;
     }
     if (quick_detect_nan(str, len)) {
-        return allow_nan;
+        token->kind = FN_NAN;
+        return;
+    }
+    if (classified == FN_NOT_NUMBER &&
+            !may_have_underscores(str, end, allow_underscores)) {
+        token->kind = FN_NOT_NUMBER;
+        return;
     }
 
-    parse_integer_macro(str, valid, {});
-    parse_decimal_macro(str, valid, {});
-    parse_exponent_macro(str, valid, {}, {});
-    return valid && str == end;
+    /* Otherwise, read the digits. */
+    scan_number(str, end, token, detail, allow_underscores);
 }
 
 
-bool
-string_contains_intlike_float(register const char *str,
-                              register const char *end)
+/* Scan a string that is trusted to hold a number in canonical form -
+ * an optional sign, digits, and an optional fraction and exponent, with
+ * no whitespace, underscores, infinity or NaN. None of the checks for
+ * those are made; the digits are scanned straight away. Anything else
+ * is still read safely (nothing past end is touched), but what it is
+ * taken for is unspecified.
+ */
+void
+tokenize_trusted_number(register const char *str, register const char *end,
+                        NumberToken *token, const TokenDetail detail)
+{
+    token->sign = consume_and_return_sign(str, end);
+    scan_number(str, end, token, detail, false);
+}
+
+
+/* Fill in a NumberToken for a number whose sign has been consumed,
+ * and that is not infinity or NaN. This is kept out of tokenize_number
+ * so that strings that the kernels classify pay nothing for it.
+ */
+static void
+scan_number(register const char *str, register const char *end,
+            NumberToken *token, const TokenDetail detail,
+            const bool allow_underscores)
 {
     register bool valid = false;
-    register bool exp_negative = false;
-    register int16_t expon = 0;
-    register uint16_t dec_length = 0;
-    register const char *int_start, *decimal_start, *decimal_end;
-
-    /* Before decimal. Keep track of number of digits read. */
-    int_start = str;
-    parse_integer_macro(str, valid, {});
-
-    /* Decimal part of float. Keep track of number of digits read */
-    /* as well as beginning and end locations. */
-    decimal_start = str;
-    parse_decimal_macro(str, valid, { dec_length += 1; });
-    decimal_end = str;
-
-    /* Exponential part of float. Parse the magnitude. */
-    parse_exponent_macro(str, valid, { exp_negative = true; }, {
-        expon *= 10;
-        expon += ascii2int(str);
+    register int64_t expon = 0;
+    register int32_t exp_sign = 1;
+    uint64_t mantissa = 0UL;
+    uint16_t ndigits = 0;  /* Significant digits in the mantissa. */
+    bool truncated = false;
+    int64_t adjust = 0;
+    Py_ssize_t nunderscores = 0;
+
+    /* Parse integer part. Leading zeros are not significant.
+     * Digits beyond what fits in the mantissa are dropped, but
+     * must still scale the result.
+     */
+    token->int_start = str;
+    parse_integer_macro(str, end, valid, allow_underscores, nunderscores, {
+        adjust += append_eight_digits(&mantissa, &ndigits, &truncated,
+                                      eight_digits(str));
+    }, {
+        if (ndigits < FN_MAX_MANTISSA_DIGITS) {
+            mantissa *= 10UL;
+            mantissa += ascii2ulong(str);
+            ndigits += mantissa != 0;
+        }
+        else {
+            truncated |= *str != '0';
+            adjust += 1;
+        }
+    });
+    token->int_end = str;
+    token->int_underscores = nunderscores;
+
+    /* Parse decimal part. */
+    nunderscores = 0;
+    token->frac_start = str != end && *str == '.' ? str + 1 : str;
+    parse_decimal_macro(str, end, valid, allow_underscores, nunderscores, {
+        adjust -= 8 - append_eight_digits(&mantissa, &ndigits, &truncated,
+                                          eight_digits(str));
+    }, {
+        if (ndigits < FN_MAX_MANTISSA_DIGITS) {
+            mantissa *= 10UL;
+            mantissa += ascii2ulong(str);
+            ndigits += mantissa != 0;
+            adjust -= 1;
+        }
+        else {
+            truncated |= *str != '0';
+        }
+    });
+    token->frac_end = str;
+    token->frac_underscores = nunderscores;
+
+    /* Parse exponential part. Saturate a huge exponent rather than
+     * overflow - the digits cannot cancel out that much of it.
+     */
+    parse_exponent_macro(str, end, valid, allow_underscores,
+                         { exp_sign = -1; }, {
+        if (expon < FN_MAX_EXPON) {
+            expon *= 10;
+            expon += ascii2int(str);
+        }
     });
 
+    token->expon = exp_sign * expon;
+    token->mantissa = mantissa;
+    token->adjust = adjust;
+    token->truncated = truncated;
+
     if (!valid || str != end) {
-        return false;
+        token->kind = FN_NOT_NUMBER;
+    }
+    else if (str == token->int_end) {
+        token->kind = FN_INT;
+    }
+    else if (detail == FN_DETAIL_NUMBER) {
+        token->kind = FN_FLOAT;
     }
     else {
         /* If we "move the decimal place" left or right depending on
          * exponent sign and magnitude, all digits after the decimal
          * must be zero.
          */
-        const uint16_t int_trailing_zeros = number_trailing_zeros(
-                                                int_start, decimal_start
-                                            );
-        const uint16_t dec_trailing_zeros =
-            decimal_start == decimal_end
-            ? 0
-            : number_trailing_zeros(decimal_start + 1, decimal_end);
-
-        if (exp_negative) {
-            return expon <= int_trailing_zeros &&
-                   dec_length == dec_trailing_zeros;
+        const Py_ssize_t frac_length = token->frac_end - token->frac_start -
+                                       token->frac_underscores;
+        token->int_trailing_zeros = number_trailing_zeros(token->int_start,
+                                                          token->int_end);
+        token->frac_trailing_zeros = number_trailing_zeros(token->frac_start,
+                                                           token->frac_end);
+        if (exp_sign < 0) {
+            token->kind = expon <= token->int_trailing_zeros &&
+                          frac_length == token->frac_trailing_zeros
+                          ? FN_INTLIKE_FLOAT : FN_FLOAT;
         }
         else {
-            return expon >= (dec_length - dec_trailing_zeros);
+            token->kind = expon >= frac_length - token->frac_trailing_zeros
+                          ? FN_INTLIKE_FLOAT : FN_FLOAT;
         }
     }
 }
 
 
-long
-parse_int(register const char *str, register const char *end, bool *error)
+/* Convert a scanned float to a double. If exact, it is correctly
+ * rounded. Otherwise any digits past the first FN_MAX_MANTISSA_DIGITS
+ * are ignored, which skips the slow path for long mantissas - the
+ * result is then the correctly rounded value of the truncated
+ * mantissa, which is less than 1e-18 (relative) below the true value,
+ * so it is always within 1 ulp (one of the two doubles either side).
+ */
+double
+number_token_to_double(const NumberToken *token, const bool exact)
 {
-    register bool valid = false;
-    register long value = 0L;
+    const int64_t q = (int64_t) token->expon + token->adjust;
+    bool ambiguous = false;
+    double retval = decimal_to_double(q, token->mantissa,
+                                      token->truncated && exact, &ambiguous);
 
-    /* Convert digits, if any. */
-    parse_integer_macro(str, valid, {
-        value *= 10L;
-        value += ascii2long(str);
-    });
+    /* If the truncated mantissa leaves the rounding undetermined,
+     * take all the digits into account.
+     */
+    if (ambiguous) {
+        retval = long_decimal_to_double(q, token->mantissa,
+                                        token->int_start, token->int_end,
+                                        token->frac_start, token->frac_end);
+    }
+    return token->sign < 0 ? -retval : retval;
+}
 
-    *error = !valid || str != end;
-    return value;
+
+/* A result for a string that is not a valid number. */
+static FnResult
+invalid_result(void)
+{
+    FnResult result;
+    result.status = FN_STATUS_INVALID;
+    result.sign = 1;
+    return result;
 }
 
 
-double
-parse_float(register const char *str, register const char *end, bool *error,
-            const int8_t sign)
+/* A result for the decimal int from start to end, whose ndigits
+ * significant digits are too many to convert here.
+ */
+static FnResult
+long_int_result(const char *start, const char *end, const Py_ssize_t ndigits)
 {
-    register bool valid = false;
-    register uint64_t intvalue = 0UL;
-    register uint16_t decimal_len = 0;
-    register int16_t expon = 0;
-    register int16_t exp_sign = 1;
-    long double retval = 0;
-
-    /* Parse integer part. */
-    parse_integer_macro(str, valid, {
-        intvalue *= 10UL;
-        intvalue += ascii2ulong(str);
-    });
+    FnResult result;
+    result.status = FN_STATUS_LONG_INT;
+    result.sign = 1;
+    result.value.digits.start = start;
+    result.value.digits.end = end;
+    result.value.digits.ndigits = ndigits;
+    result.value.digits.length = end - start;
+    result.value.digits.base = 10;
+    return result;
+}
 
-    /* Parse decimal part. */
-    parse_decimal_macro(str, valid, {
-        intvalue *= 10UL;
-        intvalue += ascii2ulong(str);
-        decimal_len += 1U;
-    });
 
-    /* Parse exponential part. */
-    parse_exponent_macro(str, valid, { exp_sign = -1; }, {
-        expon *= 10;
-        expon += ascii2int(str);
-    });
-    expon *= exp_sign;
-    expon -= decimal_len; /* Adjust the exponent by the # of decimal places */
+/* Convert the decimal digits from str to end. An int with more than
+ * FN_MAX_INT_LEN significant digits (or that does not fit in a
+ * fn_uint_t) is only checked, and left to the caller as
+ * FN_STATUS_LONG_INT.
+ */
+FnResult
+parse_int(register const char *str, register const char *end)
+{
+    const char *start = str;
+    const char *digits = NULL;
+    const char *split = NULL;
+    uint64_t high = 0;
+    uint64_t low = 0;
+    FnResult result;
+    result.sign = 1;
 
-    *error = !valid || str != end;
-    if (expon < 0) {
-        retval = (long double) intvalue / power_of_ten_scaling_factor(abs(expon));
+    /* Leading zeros are not significant. */
+    while (str != end && *str == '0') {
+        str += 1;
     }
-    else {
-        retval = (long double) intvalue * power_of_ten_scaling_factor(expon);
+
+    /* Too many digits to convert - just check they are digits. */
+    if (end - str > FN_MAX_INT_LEN) {
+        for (digits = str; digits != end && is_valid_digit(digits); digits++);
+        return digits != end
+               ? invalid_result()
+               : long_int_result(start, end, end - str);
+    }
+
+    /* Convert all but the last word of digits, then the last word. */
+    digits = str;
+    split = end - digits > FN_WORD_DIGITS ? end - FN_WORD_DIGITS : digits;
+    high = parse_digits(&digits, split);
+    if (digits == split) {
+        low = parse_digits(&digits, end);
     }
-    return (long double) sign * retval;
+    if (start == end || digits != end) {
+        return invalid_result();
+    }
+
+#if !FN_HAVE_INT128
+    /* There is at most one digit in the high word. */
+    if (high > 1 || (high == 1 && low > UINT64_MAX - FN_WORD_SCALE)) {
+        return long_int_result(start, end, end - str);
+    }
+#endif
+    result.status = FN_STATUS_INT;
+    result.value.magnitude = (fn_uint_t) high * FN_WORD_SCALE + low;
+    return result;
 }
 
 
-bool
-float_might_overflow(register const char *str, register const Py_ssize_t len)
+/* Convert an int in the given base (0 to detect it from the prefix).
+ * One that does not fit in 64 bits is only checked, and left to the
+ * caller as FN_STATUS_LONG_INT (spanning the whole string, and with
+ * the base as given).
+ */
+FnResult
+parse_int_in_base(register const char *str, register const char *end,
+                  int base, const bool allow_underscores)
 {
-    /* Locate the decimal place (if any). */
-    register const char *decimal_loc = (const char *) memchr(str, '.', len);
-    register const bool has_decimal = (bool) decimal_loc;
+    const char *start = str;
+    const int given_base = base;
+    uint64_t cutoff = 0;
+    unsigned cutlimit = 0;
+    register uint64_t value = 0;
+    register bool valid = false;
+    bool overflow = false;
+    FnResult result;
 
-    /* Find the exponent (if any) in the input.
-     * It is always after the exponent, usually close to the end, so
-     * we will start from the back. No need to include the stop
-     * location since that is either a decimal or the first digit
-     * which cannot be 'e' or 'E'.
-     */
-    register const char *ptr = NULL;
-    register const char *exp = NULL;
-    register const char *stop = decimal_loc ? decimal_loc : str;
-    for (ptr = str + len - 1; ptr > stop; ptr--) {
-        if (*ptr == 'e' || *ptr == 'E') {
-            exp = ptr;
-            break;
+    if (base == 0) {
+        base = detect_base(str, end);
+        if (base == -1) {
+            return invalid_result();
         }
     }
+    str = skip_base_prefix(str, end, base, allow_underscores);
 
-    /* If the number of pre-exponent digits is greater than the known
-     * value it might overflow.
+    /* Accumulate until the next digit would wrap around, then
+     * keep going only to validate what remains.
      */
-    if ((exp ? (exp - str) : len) - (Py_ssize_t)has_decimal > FN_DBL_DIG) {
-        return true;
+    cutoff = UINT64_MAX / (unsigned) base;
+    cutlimit = (unsigned) (UINT64_MAX % (unsigned) base);
+    parse_based_integer_macro(str, end, base, valid, allow_underscores, {
+        const unsigned digit = fn_digit_value[(unsigned char) *str];
+        if (value > cutoff || (value == cutoff && digit > cutlimit)) {
+            overflow = true;
+        }
+        value = value * base + digit;
+    });
+    if (!valid || str != end) {
+        return invalid_result();
     }
+    if (overflow) {
+        result = long_int_result(start, end, 0);
+        result.value.digits.base = given_base;
+        return result;
+    }
+    result.status = FN_STATUS_INT;
+    result.sign = 1;
+    result.value.magnitude = value;
+    return result;
+}
 
-    /* If an exponent was found, ensure it is within chosen range. */
-    if (exp) {
-        register bool neg = *(++exp) == '-'; /* First remove 'e' or 'E'. */
-        register Py_ssize_t exp_len = len - (exp - str) ;
-        if (is_sign(exp)) {
-            exp += 1;
-            exp_len -= 1;
+
+Py_ssize_t
+parse_int_to_limbs(const char *str, const char *end, uint64_t *limbs)
+{
+    const char *split = str + (end - str) % FN_WORD_DIGITS;
+    Py_ssize_t nlimbs = 0;
+    uint64_t carry = parse_digits(&str, split);
+
+    /* Start with any partial word, then multiply in whole words. */
+    if (carry != 0) {
+        limbs[nlimbs++] = carry;
+    }
+    while (str != end) {
+        register Py_ssize_t i;
+        carry = parse_digits(&str, str + FN_WORD_DIGITS);
+        for (i = 0; i < nlimbs; i++) {
+            uint64_t high, low;
+            full_multiplication(limbs[i], FN_WORD_SCALE, &high, &low);
+            low += carry;
+            limbs[i] = low;
+            carry = high + (low < carry);
         }
-        if (!(neg ? neg_exp_ok(exp_len, exp) : pos_exp_ok(exp_len, exp))) {
-            return true;
+        if (carry != 0) {
+            limbs[nlimbs++] = carry;
         }
     }
+    return nlimbs;
+}
+
+
+/* Load eight characters into a 64-bit word, first character in the
+ * least significant byte regardless of the machine byte order.
+ */
+static uint64_t
+load_eight_chars(register const char *str)
+{
+    uint64_t value;
+    memcpy(&value, str, sizeof(value));
+#if !PY_LITTLE_ENDIAN
+    value = ((value & UINT64_C(0x00000000FFFFFFFF)) << 32) |
+            ((value & UINT64_C(0xFFFFFFFF00000000)) >> 32);
+    value = ((value & UINT64_C(0x0000FFFF0000FFFF)) << 16) |
+            ((value & UINT64_C(0xFFFF0000FFFF0000)) >> 16);
+    value = ((value & UINT64_C(0x00FF00FF00FF00FF)) << 8) |
+            ((value & UINT64_C(0xFF00FF00FF00FF00)) >> 8);
+#endif
+    return value;
+}
+
 
-    /* OK. */
-    return false;
+/* Are the next eight characters (all before end) digits? Each byte
+ * must have a high nibble of 3 and a low nibble that does not carry
+ * into the high nibble when 6 is added.
+ */
+static bool
+has_eight_digits(register const char *str, register const char *end)
+{
+    register uint64_t value;
+    if (end - str < 8) {
+        return false;
+    }
+    value = load_eight_chars(str);
+    return ((value & UINT64_C(0xF0F0F0F0F0F0F0F0)) |
+            (((value + UINT64_C(0x0606060606060606)) &
+              UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4)) ==
+           UINT64_C(0x3333333333333333);
 }
 
 
-/* Given string bounds, count the number of zeros at the end. */
+/* Convert eight digits to their value with three multiplies,
+ * combining pairs of digits, then pairs of pairs, then the halves.
+ */
+static uint32_t
+eight_digits(register const char *str)
+{
+    const uint64_t mask = UINT64_C(0x000000FF000000FF);
+    const uint64_t mul1 = UINT64_C(100) + (UINT64_C(1000000) << 32);
+    const uint64_t mul2 = UINT64_C(1) + (UINT64_C(10000) << 32);
+    register uint64_t value = load_eight_chars(str);
+    value -= UINT64_C(0x3030303030303030);
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) +
+             (((value >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t) value;
+}
+
+
+/* Accumulate the digits from str up to end (at most FN_WORD_DIGITS)
+ * into a 64-bit word, stopping early at anything that is not a digit.
+ * str is left on the first character that was not consumed.
+ */
+static uint64_t
+parse_digits(register const char **str, register const char *end)
+{
+    register const char *s = *str;
+    register uint64_t value = 0;
+    while (has_eight_digits(s, end)) {
+        value = value * 100000000UL + eight_digits(s);
+        s += 8;
+    }
+    while (s != end && is_valid_digit(s)) {
+        value = value * 10UL + ascii2ulong(s);
+        s += 1;
+    }
+    *str = s;
+    return value;
+}
+
+
+/* Append the value of eight digits to a float mantissa, keeping no more
+ * than FN_MAX_MANTISSA_DIGITS significant digits. Return the number of
+ * the eight that had to be dropped, marking the mantissa as truncated
+ * if any dropped digits were non-zero.
+ */
 static uint16_t
+append_eight_digits(uint64_t *mantissa, uint16_t *ndigits, bool *truncated,
+                    const uint32_t value)
+{
+    static const uint32_t powers[] = {
+        1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U,
+        100000000U
+    };
+    register uint16_t keep, drop;
+
+    /* Leading zeros are not significant. */
+    if (*mantissa == 0) {
+        *mantissa = value;
+        for (*ndigits = 0; *ndigits < 8 && value >= powers[*ndigits]; ) {
+            *ndigits += 1;
+        }
+        return 0;
+    }
+
+    keep = FN_MAX_MANTISSA_DIGITS - *ndigits;
+    keep = keep < 8 ? keep : 8;
+    drop = 8 - keep;
+    *mantissa = *mantissa * powers[keep] + value / powers[drop];
+    *truncated |= value % powers[drop] != 0;
+    *ndigits += keep;
+    return drop;
+}
+
+
+/* Given string bounds, count the number of zeros at the end,
+ * ignoring any underscores among them.
+ */
+static Py_ssize_t
 number_trailing_zeros(register const char *start, register const char *end)
 {
-    register uint16_t n = 0;
+    register Py_ssize_t n = 0;
     for (end = end - 1; end >= start; --end) {
         if (*end == '0') {
             n += 1;
         }
-        else {
+        else if (*end != '_') {
             break;
         }
     }
@@ -308,7 +689,7 @@ int
 detect_base(register const char *str, register const char *end)
 {
     register const Py_ssize_t len = end - str;
-    if (str[0] != '0' || len == 1) {
+    if (len < 2 || str[0] != '0') {
         return 10;
     }
     else if (str[1] == 'x' || str[1] == 'X') {
@@ -320,261 +701,625 @@ detect_base(register const char *str, register const char *end)
     else if (str[1] == 'b' || str[1] == 'B') {
         return 2;
     }
-    else
-        /* "old" (C-style) octal literal illegal in 3.x. */
-        if (number_trailing_zeros(str, end) == len) {
-            return 10;
+    else {
+        /* "old" (C-style) octal literal illegal in 3.x, but zeros
+         * are fine (any underscores are checked as base 10).
+         */
+        while (str != end && (*str == '0' || *str == '_')) {
+            str += 1;
         }
-        else {
-            return -1;
+        return str == end ? 10 : -1;
+    }
+}
+
+
+/* Skip the 0x/0o/0b prefix of an int in base 16, 8 or 2 respectively.
+ * An underscore may directly follow the prefix, e.g. 0x_d4.
+ */
+static const char *
+skip_base_prefix(register const char *str, register const char *end,
+                 const int base, const bool allow_underscores)
+{
+    if (end - str > 1 && str[0] == '0' &&
+            ((base == 16 && (str[1] == 'x' || str[1] == 'X')) ||
+             (base == 8  && (str[1] == 'o' || str[1] == 'O')) ||
+             (base == 2  && (str[1] == 'b' || str[1] == 'B')))) {
+        str += 2;
+        if (allow_underscores && end - str > 1 && str[0] == '_' &&
+                is_valid_digit_arbitrary_base(str[1], base)) {
+            str += 1;
         }
+    }
+    return str;
 }
 
 
 bool
 is_valid_digit_arbitrary_base(const char c, const int base)
 {
-    if (base < 10) {
-        return c >= '0' && c <= ((int) '0' + base);
+    return fn_digit_value[(unsigned char) c] < base;
+}
+
+/* Powers of ten that are exactly representable as a double. */
+static const double exact_powers_of_ten[] = {
+    1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9, 1E10, 1E11,
+    1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19, 1E20, 1E21, 1E22
+};
+
+
+/* Multiply two 64-bit integers into a 128-bit result. */
+static void
+full_multiplication(const uint64_t a, const uint64_t b,
+                    uint64_t *high, uint64_t *low)
+{
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = (__uint128_t) a * b;
+    *high = (uint64_t) (r >> 64);
+    *low = (uint64_t) r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *low = _umul128(a, b, high);
+#else
+    const uint64_t a_lo = a & 0xFFFFFFFFU, a_hi = a >> 32;
+    const uint64_t b_lo = b & 0xFFFFFFFFU, b_hi = b >> 32;
+    const uint64_t lo_lo = a_lo * b_lo;
+    const uint64_t hi_lo = a_hi * b_lo;
+    const uint64_t lo_hi = a_lo * b_hi;
+    const uint64_t hi_hi = a_hi * b_hi;
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFU) + lo_hi;
+    *high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    *low = (cross << 32) | (lo_lo & 0xFFFFFFFFU);
+#endif
+}
+
+
+/* Count the leading zero bits of a non-zero 64-bit integer. */
+static int
+leading_zeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    register int n = 0;
+    while (!(x & (UINT64_C(1) << 63))) {
+        x <<= 1;
+        n += 1;
+    }
+    return n;
+#endif
+}
+
+
+/* Build a double from its IEEE 754 parts. */
+static double
+assemble_double(const uint64_t mantissa, const int32_t power2)
+{
+    const uint64_t bits = mantissa | ((uint64_t) power2 << 52);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+
+/* Compute the 128-bit product of a normalized w and the power-of-five
+ * table entry for q, using the second half of the table entry only when
+ * the first product leaves the rounding undetermined.
+ */
+static void
+power_of_five_product(const int64_t q, const uint64_t w,
+                      uint64_t *high, uint64_t *low)
+{
+    const uint64_t *power = fn_power_of_five_128 +
+                            2 * (q - FN_SMALLEST_POWER_OF_FIVE);
+    const uint64_t precision_mask = UINT64_C(0xFFFFFFFFFFFFFFFF) >> 55;
+
+    full_multiplication(w, power[0], high, low);
+    if ((*high & precision_mask) == precision_mask) {
+        uint64_t high2, low2;
+        full_multiplication(w, power[1], &high2, &low2);
+        *low += high2;
+        if (high2 > *low) {
+            *high += 1;
+        }
+    }
+}
+
+
+/* The binary exponent of 10**q, less 63. */
+#define binary_exponent_of_power_of_ten(q) \
+    ((int32_t) ((((152170 + 65536) * (q)) >> 16) + 63))
+
+
+/* Compute the mantissa and biased binary exponent of w * 10**q
+ * with the Eisel-Lemire algorithm. The caller must ensure that w is
+ * non-zero and that q is within the range of the power-of-five table.
+ * With the full 128-bit table the result is always correctly rounded
+ * (Mushtak & Lemire, "Fast Number Parsing Without Fallback", 2023).
+ */
+static void
+eisel_lemire(const int64_t q, uint64_t w, uint64_t *mantissa, int32_t *power2)
+{
+    const int lz = leading_zeros(w);
+    uint64_t high, low, upperbit;
+    int shift;
+
+    w <<= lz;
+    power_of_five_product(q, w, &high, &low);
+
+    upperbit = high >> 63;
+    shift = (int) upperbit + 64 - 52 - 3;
+    *mantissa = high >> shift;
+    *power2 = binary_exponent_of_power_of_ten(q) +
+              (int32_t) upperbit - lz + 1023;
+
+    /* Subnormal result, or zero if it is too small even for that. */
+    if (*power2 <= 0) {
+        if (-*power2 + 1 >= 64) {
+            *mantissa = 0;
+            *power2 = 0;
+            return;
+        }
+        *mantissa >>= -*power2 + 1;
+        *mantissa += *mantissa & 1;
+        *mantissa >>= 1;
+        *power2 = *mantissa < (UINT64_C(1) << 52) ? 0 : 1;
+        return;
+    }
+
+    /* Break ties to even - the product is exact only for small q. */
+    if (low <= 1 && q >= -4 && q <= 23 && (*mantissa & 3) == 1 &&
+            (*mantissa << shift) == high) {
+        *mantissa &= ~UINT64_C(1);
+    }
+
+    /* Round, then renormalize if rounding carried into a new bit. */
+    *mantissa += *mantissa & 1;
+    *mantissa >>= 1;
+    if (*mantissa >= (UINT64_C(2) << 52)) {
+        *mantissa = UINT64_C(1) << 52;
+        *power2 += 1;
+    }
+    *mantissa &= ~(UINT64_C(1) << 52);
+
+    /* Too large, so infinity. */
+    if (*power2 >= 0x7FF) {
+        *mantissa = 0;
+        *power2 = 0x7FF;
+    }
+}
+
+
+/* Correctly round the decimal w * 10**q to a double.
+ * If w was truncated from a longer mantissa, the result is only known
+ * if both w and w + 1 round to the same double - if they do not,
+ * "ambiguous" is set and the caller must use a slower method.
+ */
+static double
+decimal_to_double(const int64_t q, const uint64_t w, const bool truncated,
+                  bool *ambiguous)
+{
+    uint64_t mantissa, mantissa_up;
+    int32_t power2, power2_up;
+
+#if FN_EXACT_DOUBLE_ARITHMETIC
+    /* Clinger's fast path. */
+    if (!truncated && q >= FN_MIN_EXP && q <= FN_MAX_EXP &&
+            w <= FN_MAX_EXACT_MANTISSA) {
+        return q < 0
+               ? (double) w / exact_powers_of_ten[-q]
+               : (double) w * exact_powers_of_ten[q];
+    }
+#endif
+
+    if (w == 0 || q < FN_SMALLEST_POWER_OF_FIVE) {
+        return 0.0;
+    }
+    if (q > FN_LARGEST_POWER_OF_FIVE) {
+        return Py_HUGE_VAL;
+    }
+
+    eisel_lemire(q, w, &mantissa, &power2);
+    if (truncated) {
+        eisel_lemire(q, w + 1, &mantissa_up, &power2_up);
+        if (mantissa != mantissa_up || power2 != power2_up) {
+            *ambiguous = true;
+            return 0.0;
+        }
+    }
+    return assemble_double(mantissa, power2);
+}
+
+
+/* The slow path, for long mantissas for which the truncated
+ * Eisel-Lemire result was ambiguous. All significant digits are
+ * loaded into a big integer and compared exactly against the halfway
+ * point between the two candidate doubles (the "digit comparison"
+ * method of Clinger and of the fast_float library). At most
+ * FN_MAX_BIG_DIGITS digits are needed to decide any double, so the
+ * big integer has a fixed size and memory use is bounded regardless
+ * of the input length.
+ */
+#define FN_MAX_BIG_DIGITS 769
+#define FN_BIGINT_BITS 4000
+#define FN_BIGINT_LIMBS ((FN_BIGINT_BITS + 31) / 32)
+
+/* Little-endian 32-bit limbs, with no leading zero limbs. */
+typedef struct BigInt {
+    uint32_t limbs[FN_BIGINT_LIMBS];
+    uint32_t len;
+} BigInt;
+
+/* A double with an unpacked 64-bit mantissa and biased exponent. */
+typedef struct ExtendedFloat {
+    uint64_t mantissa;
+    int32_t power2;
+} ExtendedFloat;
+
+/* How to round when an extended float is narrowed to a double. */
+typedef enum Rounding {
+    ROUND_DOWN,           /* Always truncate. */
+    ROUND_NEAREST,        /* Ties to even, or up if digits were dropped. */
+    ROUND_BY_COMPARISON   /* Up, down or even as decided by a comparison. */
+} Rounding;
+
+/* Powers of ten that fit in a limb. */
+static const uint32_t limb_powers_of_ten[] = {
+    1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U,
+    100000000U, 1000000000U
+};
+#define FN_DIGITS_PER_LIMB 9
+
+
+static void
+bigint_from_uint64(BigInt *big, const uint64_t value)
+{
+    big->limbs[0] = (uint32_t) value;
+    big->limbs[1] = (uint32_t) (value >> 32);
+    big->len = big->limbs[1] ? 2 : (big->limbs[0] ? 1 : 0);
+}
+
+
+/* big = big * mul + add */
+static void
+bigint_mul_add(BigInt *big, const uint32_t mul, const uint32_t add)
+{
+    register uint32_t i;
+    register uint64_t carry = add;
+    for (i = 0; i < big->len; i++) {
+        const uint64_t z = (uint64_t) big->limbs[i] * mul + carry;
+        big->limbs[i] = (uint32_t) z;
+        carry = z >> 32;
+    }
+    if (carry && big->len < FN_BIGINT_LIMBS) {
+        big->limbs[big->len] = (uint32_t) carry;
+        big->len += 1;
+    }
+}
+
+
+/* big = big * 2**n */
+static void
+bigint_pow2(BigInt *big, const uint32_t n)
+{
+    const uint32_t limb_shift = n / 32;
+    const uint32_t bit_shift = n % 32;
+    register int32_t i;
+
+    if (big->len == 0) {
+        return;
+    }
+    if (bit_shift) {
+        uint32_t carry = 0;
+        for (i = 0; i < (int32_t) big->len; i++) {
+            const uint32_t limb = big->limbs[i];
+            big->limbs[i] = (limb << bit_shift) | carry;
+            carry = limb >> (32 - bit_shift);
+        }
+        if (carry && big->len < FN_BIGINT_LIMBS) {
+            big->limbs[big->len] = carry;
+            big->len += 1;
+        }
+    }
+    if (limb_shift) {
+        const uint32_t new_len = big->len + limb_shift < FN_BIGINT_LIMBS
+                                 ? big->len + limb_shift : FN_BIGINT_LIMBS;
+        for (i = (int32_t) new_len - 1; i >= (int32_t) limb_shift; i--) {
+            big->limbs[i] = big->limbs[i - limb_shift];
+        }
+        for (; i >= 0; i--) {
+            big->limbs[i] = 0;
+        }
+        big->len = new_len;
+    }
+}
+
+
+/* big = big * 5**n */
+static void
+bigint_pow5(BigInt *big, uint32_t n)
+{
+    /* 5**13 is the largest power of five that fits in a limb. */
+    while (n >= 13) {
+        bigint_mul_add(big, 1220703125U, 0);
+        n -= 13;
+    }
+    if (n) {
+        uint32_t mul = 1;
+        while (n--) {
+            mul *= 5;
+        }
+        bigint_mul_add(big, mul, 0);
+    }
+}
+
+
+static uint32_t
+bigint_bit_length(const BigInt *big)
+{
+    if (big->len == 0) {
+        return 0;
+    }
+    return 32 * big->len -
+           (uint32_t) leading_zeros((uint64_t) big->limbs[big->len - 1]) + 32;
+}
+
+
+/* The 64 most significant bits, normalized so the top bit is set.
+ * "truncated" is set if any less significant bits are non-zero.
+ */
+static uint64_t
+bigint_hi64(const BigInt *big, bool *truncated)
+{
+    const uint32_t nbits = bigint_bit_length(big);
+    uint64_t result = 0;
+    register int32_t i;
+    register uint32_t bit;
+
+    *truncated = false;
+    if (nbits <= 64) {
+        for (i = (int32_t) big->len - 1; i >= 0; i--) {
+            result = (result << 32) | big->limbs[i];
+        }
+        return nbits ? result << (64 - nbits) : 0;
+    }
+
+    /* Collect the top three limbs (enough to hold 64 bits at any
+     * alignment), then shift so the top bit lands at bit 63.
+     */
+    bit = nbits - 64;  /* Index of the lowest bit kept. */
+    for (i = (int32_t) big->len - 1; i >= (int32_t) (bit / 32); i--) {
+        const uint32_t limb = big->limbs[i];
+        const uint32_t offset = 32 * (uint32_t) i;
+        if (offset >= bit) {
+            result |= (uint64_t) limb << (offset - bit);
+        }
+        else {
+            result |= (uint64_t) limb >> (bit - offset);
+            *truncated |= (limb << (32 - (bit - offset))) != 0;
+        }
+    }
+    for (; i >= 0; i--) {
+        *truncated |= big->limbs[i] != 0;
+    }
+    return result;
+}
+
+
+static int
+bigint_compare(const BigInt *a, const BigInt *b)
+{
+    register int32_t i;
+    if (a->len != b->len) {
+        return a->len > b->len ? 1 : -1;
+    }
+    for (i = (int32_t) a->len - 1; i >= 0; i--) {
+        if (a->limbs[i] != b->limbs[i]) {
+            return a->limbs[i] > b->limbs[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+
+/* Load up to FN_MAX_BIG_DIGITS significant digits from the integer
+ * and fraction spans, skipping any underscores. If non-zero digits
+ * remain after that, add a trailing one so that the value is not
+ * mistaken for a halfway point. Return the number of digits loaded.
+ */
+static uint32_t
+bigint_load_digits(BigInt *big, const char *int_start, const char *int_end,
+                   const char *frac_start, const char *frac_end)
+{
+    const char *spans[2][2] = {{int_start, int_end}, {frac_start, frac_end}};
+    register const char *str;
+    register uint32_t value = 0;
+    register uint32_t counter = 0;
+    uint32_t ndigits = 0;
+    int i;
+
+    big->len = 0;
+    for (i = 0; i < 2; i++) {
+        const char *end = spans[i][1];
+        str = spans[i][0];
+        if (ndigits == 0) {
+            while (str != end && (*str == '0' || *str == '_')) {
+                str += 1;
+            }
+        }
+        for (; str != end; str += 1) {
+            if (*str == '_') {
+                continue;
+            }
+            if (ndigits == FN_MAX_BIG_DIGITS) {
+                bool truncated = false;
+                for (; str != end && !truncated; str += 1) {
+                    truncated = *str != '0' && *str != '_';
+                }
+                if (i == 0) {
+                    for (str = frac_start; str != frac_end && !truncated; str += 1) {
+                        truncated = *str != '0' && *str != '_';
+                    }
+                }
+                bigint_mul_add(big, limb_powers_of_ten[counter], value);
+                if (truncated) {
+                    bigint_mul_add(big, 10, 1);
+                    ndigits += 1;
+                }
+                return ndigits;
+            }
+            value = value * 10 + (uint32_t) ascii2int(str);
+            counter += 1;
+            ndigits += 1;
+            if (counter == FN_DIGITS_PER_LIMB) {
+                bigint_mul_add(big, limb_powers_of_ten[counter], value);
+                counter = 0;
+                value = 0;
+            }
+        }
+    }
+    if (counter) {
+        bigint_mul_add(big, limb_powers_of_ten[counter], value);
+    }
+    return ndigits;
+}
+
+
+/* Shift the mantissa right, deciding whether to round up. */
+static void
+extended_float_shift(ExtendedFloat *am, const int32_t shift,
+                     const Rounding rounding, const int hint)
+{
+    const uint64_t mask = shift == 64
+                          ? UINT64_MAX : (UINT64_C(1) << shift) - 1;
+    const uint64_t halfway = shift == 0 ? 0 : UINT64_C(1) << (shift - 1);
+    const uint64_t truncated_bits = am->mantissa & mask;
+    const bool is_above = truncated_bits > halfway;
+    const bool is_halfway = truncated_bits == halfway;
+    bool is_odd, round_up = false;
+
+    am->mantissa = shift == 64 ? 0 : am->mantissa >> shift;
+    am->power2 += shift;
+    is_odd = am->mantissa & 1;
+
+    switch (rounding) {
+    case ROUND_DOWN:
+        break;
+    case ROUND_NEAREST:
+        round_up = is_above || (is_halfway && (hint || is_odd));
+        break;
+    case ROUND_BY_COMPARISON:
+        round_up = hint > 0 || (hint == 0 && is_odd);
+        break;
+    }
+    am->mantissa += round_up;
+}
+
+
+/* Narrow an extended float to the mantissa and exponent of a double. */
+static void
+extended_float_round(ExtendedFloat *am, const Rounding rounding,
+                     const int hint)
+{
+    const int32_t mantissa_shift = 64 - 52 - 1;
+
+    /* Subnormal. Rounding may carry into the hidden bit. */
+    if (-am->power2 >= mantissa_shift) {
+        const int32_t shift = -am->power2 + 1;
+        extended_float_shift(am, shift < 64 ? shift : 64, rounding, hint);
+        am->power2 = am->mantissa < (UINT64_C(1) << 52) ? 0 : 1;
+        return;
+    }
+
+    extended_float_shift(am, mantissa_shift, rounding, hint);
+    if (am->mantissa >= (UINT64_C(2) << 52)) {
+        am->mantissa = UINT64_C(1) << 52;
+        am->power2 += 1;
+    }
+    am->mantissa &= ~(UINT64_C(1) << 52);
+    if (am->power2 >= 0x7FF) {
+        am->mantissa = 0;
+        am->power2 = 0x7FF;
+    }
+}
+
+
+static double
+long_decimal_to_double(const int64_t q, uint64_t w,
+                       const char *int_start, const char *int_end,
+                       const char *frac_start, const char *frac_end)
+{
+    const int32_t bias = 52 + 1023;
+    const int lz = leading_zeros(w);
+    int32_t sci_exp = (int32_t) q;
+    int32_t exponent;
+    uint32_t ndigits;
+    uint64_t high, low, scaled;
+    ExtendedFloat am;
+    BigInt real_digits;
+
+    if (w == 0) {
+        return 0.0;
+    }
+
+    /* The truncated product, unrounded. It is within one unit of the
+     * correct result, which is decided by the comparison below.
+     */
+    power_of_five_product(q, w << lz, &high, &low);
+    am.mantissa = high << ((high >> 63) ^ 1);
+    am.power2 = binary_exponent_of_power_of_ten(q) + bias -
+                (int32_t) ((high >> 63) ^ 1) - lz - 62;
+
+    /* The exponent of the leading digit, in scientific notation. */
+    for (scaled = w; scaled >= 10; scaled /= 10) {
+        sci_exp += 1;
+    }
+
+    ndigits = bigint_load_digits(&real_digits, int_start, int_end,
+                                 frac_start, frac_end);
+    exponent = sci_exp + 1 - (int32_t) ndigits;
+
+    if (exponent >= 0) {
+        /* The value is an integer - compute it exactly and round. */
+        bool truncated;
+        bigint_pow5(&real_digits, (uint32_t) exponent);
+        bigint_pow2(&real_digits, (uint32_t) exponent);
+        am.mantissa = bigint_hi64(&real_digits, &truncated);
+        am.power2 = (int32_t) bigint_bit_length(&real_digits) - 64 + bias;
+        extended_float_round(&am, ROUND_NEAREST, truncated);
     }
     else {
-        register const char offset = (char) base - 10;
-        return (c >= '0' && c <= '9') ||
-               (c >= 'a' && c <= 'a' + offset) ||
-               (c >= 'A' && c <= 'A' + offset);
-    }
-}
-
-
-/* Calculate the exponential scaling factor with hard-coded values. */
-long double
-power_of_ten_scaling_factor(const int expon) {
-    switch (expon) {
-    case 0:
-        return 1E0L;
-    case 1:
-        return 1E1L;
-    case 2:
-        return 1E2L;
-    case 3:
-        return 1E3L;
-    case 4:
-        return 1E4L;
-    case 5:
-        return 1E5L;
-    case 6:
-        return 1E6L;
-    case 7:
-        return 1E7L;
-    case 8:
-        return 1E8L;
-    case 9:
-        return 1E9L;
-    case 10:
-        return 1E10L;
-    case 11:
-        return 1E11L;
-    case 12:
-        return 1E12L;
-    case 13:
-        return 1E13L;
-    case 14:
-        return 1E14L;
-    case 15:
-        return 1E15L;
-    case 16:
-        return 1E16L;
-    case 17:
-        return 1E17L;
-    case 18:
-        return 1E18L;
-    case 19:
-        return 1E19L;
-    case 20:
-        return 1E20L;
-    case 21:
-        return 1E21L;
-    case 22:
-        return 1E22L;
-    case 23:
-        return 1E23L;
-    case 24:
-        return 1E24L;
-    case 25:
-        return 1E25L;
-    case 26:
-        return 1E26L;
-    case 27:
-        return 1E27L;
-    case 28:
-        return 1E28L;
-    case 29:
-        return 1E29L;
-    case 30:
-        return 1E30L;
-    case 31:
-        return 1E31L;
-    case 32:
-        return 1E32L;
-    case 33:
-        return 1E33L;
-    case 34:
-        return 1E34L;
-    case 35:
-        return 1E35L;
-    case 36:
-        return 1E36L;
-    case 37:
-        return 1E37L;
-    case 38:
-        return 1E38L;
-    case 39:
-        return 1E39L;
-    case 40:
-        return 1E40L;
-    case 41:
-        return 1E41L;
-    case 42:
-        return 1E42L;
-    case 43:
-        return 1E43L;
-    case 44:
-        return 1E44L;
-    case 45:
-        return 1E45L;
-    case 46:
-        return 1E46L;
-    case 47:
-        return 1E47L;
-    case 48:
-        return 1E48L;
-    case 49:
-        return 1E49L;
-    case 50:
-        return 1E50L;
-    case 51:
-        return 1E51L;
-    case 52:
-        return 1E52L;
-    case 53:
-        return 1E53L;
-    case 54:
-        return 1E54L;
-    case 55:
-        return 1E55L;
-    case 56:
-        return 1E56L;
-    case 57:
-        return 1E57L;
-    case 58:
-        return 1E58L;
-    case 59:
-        return 1E59L;
-    case 60:
-        return 1E60L;
-    case 61:
-        return 1E61L;
-    case 62:
-        return 1E62L;
-    case 63:
-        return 1E63L;
-    case 64:
-        return 1E64L;
-    case 65:
-        return 1E65L;
-    case 66:
-        return 1E66L;
-    case 67:
-        return 1E67L;
-    case 68:
-        return 1E68L;
-    case 69:
-        return 1E69L;
-    case 70:
-        return 1E70L;
-    case 71:
-        return 1E71L;
-    case 72:
-        return 1E72L;
-    case 73:
-        return 1E73L;
-    case 74:
-        return 1E74L;
-    case 75:
-        return 1E75L;
-    case 76:
-        return 1E76L;
-    case 77:
-        return 1E77L;
-    case 78:
-        return 1E78L;
-    case 79:
-        return 1E79L;
-    case 80:
-        return 1E80L;
-    case 81:
-        return 1E81L;
-    case 82:
-        return 1E82L;
-    case 83:
-        return 1E83L;
-    case 84:
-        return 1E84L;
-    case 85:
-        return 1E85L;
-    case 86:
-        return 1E86L;
-    case 87:
-        return 1E87L;
-    case 88:
-        return 1E88L;
-    case 89:
-        return 1E89L;
-    case 90:
-        return 1E90L;
-    case 91:
-        return 1E91L;
-    case 92:
-        return 1E92L;
-    case 93:
-        return 1E93L;
-    case 94:
-        return 1E94L;
-    case 95:
-        return 1E95L;
-    case 96:
-        return 1E96L;
-    case 97:
-        return 1E97L;
-    case 98:
-        return 1E98L;
-    case 99:
-        return 1E99L;
-    case 100:
-        return 1E100L;
-    case 101:
-        return 1E101L;
-    case 102:
-        return 1E102L;
-    case 103:
-        return 1E103L;
-    case 104:
-        return 1E104L;
-    case 105:
-        return 1E105L;
-    case 106:
-        return 1E106L;
-    case 107:
-        return 1E107L;
-    case 108:
-        return 1E108L;
-    case 109:
-        return 1E109L;
-    case 110:
-        return 1E110L;
-    /* We should never see anything larger than 99. */
-    /* This should never be reached. */
-    default:
-        return 1E308L;
+        /* Compare the digits against the halfway point between the
+         * double below (b) and above it, both scaled to an integer
+         * times the same power of two.
+         */
+        ExtendedFloat am_b = am;
+        ExtendedFloat halfway;
+        BigInt halfway_digits;
+        int32_t pow2_exp;
+
+        extended_float_round(&am_b, ROUND_DOWN, 0);
+        if (am_b.power2 == 0) {
+            halfway.mantissa = am_b.mantissa;
+            halfway.power2 = 1 - bias;
+        }
+        else {
+            halfway.mantissa = am_b.mantissa | (UINT64_C(1) << 52);
+            halfway.power2 = am_b.power2 - bias;
+        }
+        halfway.mantissa = 2 * halfway.mantissa + 1;
+        halfway.power2 -= 1;
+
+        bigint_from_uint64(&halfway_digits, halfway.mantissa);
+        bigint_pow5(&halfway_digits, (uint32_t) -exponent);
+        pow2_exp = halfway.power2 - exponent;
+        if (pow2_exp > 0) {
+            bigint_pow2(&halfway_digits, (uint32_t) pow2_exp);
+        }
+        else if (pow2_exp < 0) {
+            bigint_pow2(&real_digits, (uint32_t) -pow2_exp);
+        }
+
+        extended_float_round(&am, ROUND_BY_COMPARISON,
+                             bigint_compare(&real_digits, &halfway_digits));
     }
+    return assemble_double(am.mantissa, am.power2);
 }
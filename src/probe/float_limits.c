@@ -0,0 +1,121 @@
+/*
+ * Build-time probe of the range of Clinger's fast path.
+ *
+ * setup.py compiles this with the same compiler and flags as the
+ * extension, runs it, and passes what it prints on to the compiler as
+ * macros (see "Overflow detection" in parsing.h).
+ *
+ * A mantissa w of up to 53 bits scaled by 10**q with a single double
+ * multiply or divide is correctly rounded if the operation is rounded
+ * only once. That is always so if doubles are evaluated in double
+ * precision. With more precision (x87 extended precision) the result
+ * is rounded twice, which is still correct if the first rounding is
+ * exact - if the 5**q part of 10**q has fewer bits than the extra
+ * precision. The range this allows is then checked against strtod for
+ * many mantissas, and narrowed if anything is not correctly rounded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest exponent that can ever be used (the last power of ten
+ * that is exact as a double, and so the size of the parser's table).
+ */
+#define MAX_EXP 22
+
+/* Mantissas to try for each exponent. */
+#define N_SAMPLES 50000
+
+static const double powers_of_ten[] = {
+    1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9, 1E10, 1E11,
+    1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19, 1E20, 1E21, 1E22
+};
+
+/* xorshift64 - a fixed sequence, so that builds are reproducible. */
+static unsigned long long state = 88172645463325252ULL;
+
+static unsigned long long
+next_random(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+
+/* Is w * 10**q correctly rounded by a single multiply or divide for
+ * every mantissa tried?
+ */
+static int
+scaling_is_exact(const int q)
+{
+    char buffer[64];
+    long i;
+    for (i = 0; i < N_SAMPLES; i++) {
+        /* Mantissas of every length, up to and including 2**53. */
+        const unsigned long long w =
+            i == 0 ? 1ULL << 53 : next_random() >> (11 + i % 53);
+        /* Volatile, so that nothing is computed at compile time. */
+        volatile double mantissa = (double) w;
+        volatile double power = powers_of_ten[q < 0 ? -q : q];
+        volatile double result = q < 0 ? mantissa / power : mantissa * power;
+        sprintf(buffer, "%llue%d", w, q);
+        if (result != strtod(buffer, NULL)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/* How many significant bits double expressions are evaluated with. */
+static int
+evaluation_precision(void)
+{
+    volatile double one = 1.0;
+    volatile double epsilon = 0.5;
+    int bits = 1;
+    while ((one + epsilon) - one != 0.0) {
+        epsilon /= 2.0;
+        bits += 1;
+    }
+    return bits;
+}
+
+
+/* The largest exponent for which w * 10**q is rounded only once. */
+static int
+largest_exact_exponent(void)
+{
+    const int extra_bits = evaluation_precision() - 53;
+    unsigned long long power_of_five = 1;
+    int q = 0;
+    if (extra_bits <= 0) {
+        return MAX_EXP;
+    }
+    while (q < MAX_EXP && extra_bits < 64 &&
+            power_of_five * 5 < 1ULL << extra_bits) {
+        power_of_five *= 5;
+        q += 1;
+    }
+    return q;
+}
+
+
+int
+main(void)
+{
+    const int limit = largest_exact_exponent();
+    int max_exp = 0;
+    int min_exp = 0;
+    while (max_exp < limit && scaling_is_exact(max_exp + 1)) {
+        max_exp += 1;
+    }
+    while (min_exp > -limit && scaling_is_exact(min_exp - 1)) {
+        min_exp -= 1;
+    }
+    printf("FN_PROBED_MAX_EXP %d\n", max_exp);
+    printf("FN_PROBED_MIN_EXP %d\n", min_exp);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/* Per-thread scratch space.
+ *
+ * Each thread has a stack of chunks of memory. Space is reserved from
+ * the newest chunk, and when that is full a new chunk (at least twice
+ * as large) is pushed. Releasing to a mark pops the chunks pushed since
+ * then, keeping one of them as a spare, so a thread that repeatedly
+ * parses the same sort of string stops allocating after the first.
+ *
+ * The scratch space of a thread is owned by a capsule in its thread
+ * state dictionary, so it is freed along with the thread state. It is
+ * plain memory, so a thread can use it in whichever interpreter it is
+ * running, and it is only ever freed by the thread itself (even for a
+ * subinterpreter, all of whose other threads must be gone by the time
+ * it is ended) or at exit.
+ */
+#include <Python.h>
+#include <stdlib.h>
+#include "fastnumbers/scratch.h"
+#include "fastnumbers/pstdint.h"
+
+/* Name of the capsule in the thread state dictionary. */
+#define FN_SCRATCH_KEY "fastnumbers.scratch"
+
+/* Reserved space is aligned to this many bytes. */
+#define FN_SCRATCH_ALIGN 16
+#define align_up(n) \
+    (((n) + FN_SCRATCH_ALIGN - 1) & ~((size_t) FN_SCRATCH_ALIGN - 1))
+
+/* The data of a chunk directly follows its header. */
+#define chunk_data(chunk) ((char *) (chunk) + align_up(sizeof(ScratchChunk)))
+
+typedef struct ScratchChunk {
+    struct ScratchChunk *prev;  /* The chunk pushed before this one. */
+    size_t size;                /* Bytes of data. */
+    size_t used;                /* Bytes of data that are reserved. */
+} ScratchChunk;
+
+typedef struct Scratch {
+    ScratchChunk *current;  /* Newest chunk, or NULL if none. */
+    ScratchChunk *spare;    /* A released chunk kept for reuse. */
+    Py_ssize_t heap_allocations;
+} Scratch;
+
+static FN_THREAD_LOCAL Scratch *thread_scratch = NULL;
+
+/* Forward declarations. */
+static Scratch *
+new_scratch(void);
+static void
+free_scratch(PyObject *capsule);
+static ScratchChunk *
+push_chunk(Scratch *scratch, const size_t need);
+static void
+pop_chunk(Scratch *scratch);
+
+
+void
+scratch_mark(ScratchMark *mark)
+{
+    const Scratch *scratch = thread_scratch;
+    mark->chunk = scratch != NULL ? scratch->current : NULL;
+    mark->used = mark->chunk != NULL ? mark->chunk->used : 0;
+}
+
+
+void *
+scratch_reserve(const size_t size)
+{
+    Scratch *scratch = thread_scratch;
+    ScratchChunk *chunk = NULL;
+    const size_t need = align_up(size);
+
+    if (scratch == NULL && (scratch = new_scratch()) == NULL) {
+        return NULL;
+    }
+    chunk = scratch->current;
+    if (chunk == NULL || chunk->size - chunk->used < need) {
+        if ((chunk = push_chunk(scratch, need)) == NULL) {
+            return NULL;
+        }
+    }
+    chunk->used += need;
+    return chunk_data(chunk) + chunk->used - need;
+}
+
+
+void
+scratch_release(const ScratchMark *mark)
+{
+    Scratch *scratch = thread_scratch;
+    if (scratch == NULL) {
+        return;
+    }
+    while (scratch->current != mark->chunk) {
+        pop_chunk(scratch);
+    }
+    if (scratch->current != NULL) {
+        scratch->current->used = mark->used;
+    }
+}
+
+
+Py_ssize_t
+scratch_heap_allocations(void)
+{
+    return thread_scratch != NULL ? thread_scratch->heap_allocations : 0;
+}
+
+
+/* Create the scratch space of this thread, handing it to a capsule
+ * in the thread state dictionary.
+ */
+static Scratch *
+new_scratch(void)
+{
+    PyObject *dict = PyThreadState_GetDict();
+    PyObject *capsule = NULL;
+    Scratch *scratch = NULL;
+
+    if (dict == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "no thread state for scratch");
+        return NULL;
+    }
+    if ((scratch = calloc(1, sizeof(Scratch))) == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    if ((capsule = PyCapsule_New(scratch, NULL, free_scratch)) == NULL) {
+        free(scratch);
+        return NULL;
+    }
+    if (PyDict_SetItemString(dict, FN_SCRATCH_KEY, capsule) < 0) {
+        Py_DECREF(capsule);  /* Frees the scratch space. */
+        return NULL;
+    }
+    Py_DECREF(capsule);
+    scratch->heap_allocations = 1;
+    thread_scratch = scratch;
+    return scratch;
+}
+
+
+/* Free the scratch space of a thread when its capsule goes away. This
+ * may run in another thread (e.g. at exit), whose own scratch space
+ * must be left alone.
+ */
+static void
+free_scratch(PyObject *capsule)
+{
+    Scratch *scratch = (Scratch *) PyCapsule_GetPointer(capsule, NULL);
+    if (thread_scratch == scratch) {
+        thread_scratch = NULL;
+    }
+    while (scratch->current != NULL) {
+        pop_chunk(scratch);
+    }
+    free(scratch->spare);
+    free(scratch);
+}
+
+
+/* Push a chunk with room for at least need bytes, reusing the spare
+ * chunk if it is large enough. Chunks at least double in size, so
+ * few are ever needed at once.
+ */
+static ScratchChunk *
+push_chunk(Scratch *scratch, const size_t need)
+{
+    ScratchChunk *chunk = scratch->spare;
+    size_t size = scratch->current != NULL ? 2 * scratch->current->size
+                                           : FN_SCRATCH_CHUNK_SIZE;
+    size = size < need ? need : size;
+
+    if (chunk != NULL && chunk->size >= need) {
+        scratch->spare = NULL;
+    }
+    else {
+        chunk = malloc(align_up(sizeof(ScratchChunk)) + size);
+        if (chunk == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        chunk->size = size;
+        scratch->heap_allocations += 1;
+    }
+    chunk->prev = scratch->current;
+    chunk->used = 0;
+    scratch->current = chunk;
+    return chunk;
+}
+
+
+/* Pop the newest chunk, keeping it as the spare if it is the largest
+ * released so far (but not too large to keep).
+ */
+static void
+pop_chunk(Scratch *scratch)
+{
+    ScratchChunk *chunk = scratch->current;
+    scratch->current = chunk->prev;
+    if (chunk->size <= FN_SCRATCH_MAX_KEPT &&
+            (scratch->spare == NULL || scratch->spare->size < chunk->size)) {
+        free(scratch->spare);
+        scratch->spare = chunk;
+    }
+    else {
+        free(chunk);
+    }
+}
@@ -4,17 +4,39 @@
  * Author: Seth M. Morton
  *
  * July 2018
+ *
+ * A conversion is done in two steps. The characters are first parsed
+ * into an FnResult (see parsing.h) by functions that use no Python
+ * objects, and so can run without the GIL; only then is a Python
+ * object built from the result (or an error set) at the boundary.
  */
 
 #include <Python.h>
 #include <string.h>
 #include <limits.h>
+#include <float.h>
+#include "fastnumbers/fn_inline.h"
+#include "fastnumbers/kernels.h"
 #include "fastnumbers/strings.h"
 #include "fastnumbers/unicode_character.h"
 #include "fastnumbers/numbers.h"
 #include "fastnumbers/options.h"
 #include "fastnumbers/parsing.h"
 #include "fastnumbers/pstdint.h"
+#include "fastnumbers/scratch.h"
+
+
+/* CPython only enforces sys.set_int_max_str_digits above this many digits. */
+#define FN_MAX_STR_DIGITS_THRESHOLD 640
+
+/* Unicode strings up to this long are narrowed to ASCII on the stack. */
+#define FN_NARROW_BUFFER_LEN 64
+
+/* Query an option, unless the options are known to be the defaults
+ * (see PyString_to_PyNumber), in which case the answer is a constant.
+ */
+#define OPTION(defaults, query, default_value) \
+    ((defaults) ? (default_value) : (query))
 
 
 #define STRING_TYPE_CHECK(o) (PyBytes_Check(o) || \
@@ -24,120 +46,400 @@
 
 
 /* Forward declarations */
+FN_INLINE(FnResult)
+token_to_float_result(const NumberToken *token, const bool exact);
+static FnResult
+token_to_int_result(const NumberToken *token);
+static FnResult
+token_to_forced_int_result(const NumberToken *token);
+static FnResult
+based_int_result(const char *str, const char *end, const int base,
+                 const bool allow_underscores);
+static FnResult
+digits_result(const char *start, const char *stop, const Py_ssize_t ndigits,
+              const Py_ssize_t length, const int8_t sign);
+static FnResult
+invalid_result(void);
+static void
+copy_int_digits(const char *start, const char *stop, char *out,
+                const Py_ssize_t len);
+static PyObject *
+long_result_to_PyInt(const FnResult *result, const char *str,
+                     const char *end, const Options *options);
+static PyObject *
+python_lib_str_to_PyInt(const char *str, const char *end, const int base,
+                        const Options *options);
+static const char *
+PyUnicode_as_narrow_string(PyObject *obj, Py_ssize_t *len, char *narrow,
+                           bool *error);
+static bool
+is_ascii(const char *str, const Py_ssize_t len);
+static void
+release_PyString_str(const ScratchMark *mark, Py_buffer *view);
+static PyObject *
+PyLong_from_fn_uint(const fn_uint_t value, const long sign);
+static bool
+within_int_max_str_digits(const Py_ssize_t len);
+static PyObject *
+long_digits_to_PyInt(const char *str, const char *end, const long sign);
 static PyObject *
-str_to_PyInt(const char *str, const char *end, const Options *options);
+digits_to_PyLong(const char *str, const char *end, uint64_t *limbs,
+                 PyObject **powers);
 static PyObject *
-str_to_PyFloat(const char *str, const char *end,
-               const Options *options);
+power_of_ten_blocks(const int k, PyObject **powers);
+static PyObject *
+PyLong_from_limbs(uint64_t *limbs, const Py_ssize_t nlimbs);
+static bool
+token_is_type(const NumberToken *token, const PyNumberType type,
+              const Options *options);
+static Py_ssize_t
+number_token_int_digits(const NumberToken *token);
+static bool
+number_token_overflows_double(const NumberToken *token);
 
 
-static PyObject *
-str_to_PyInt_or_PyFloat(const char *str, const char *end,
-                        const Options *options)
+/* Parse the characters from str to end as the given type of number.
+ * Unless it is an int with an explicit base, everything that is needed
+ * is found by a single scan. Trusted input is scanned without checking
+ * for anything but digits, and only needs to tell int-like floats from
+ * other floats when coercing them. This is compiled both for any
+ * options, and for each type with the default options (see
+ * string_to_number).
+ */
+FN_INLINE(FnResult)
+chars_to_result(const char *str, const char *end, const PyNumberType type,
+                const Options *options, const bool defaults)
 {
-    const char *start = str;
-    PyObject *pyresult = NULL;
+    const int base = OPTION(defaults, Options_Default_Base(options), true)
+                     ? 10 : options->base;
+    const bool trusted = OPTION(defaults, Options_Trusted(options), false) &&
+                         (type != INT || base == 10);
+    NumberToken token;
+
+    if (type == INT && base != 10) {
+        return based_int_result(str, end, base,
+                                Options_Allow_Underscores(options));
+    }
+    if (trusted) {
+        tokenize_trusted_number(
+            str, end, &token,
+            type == REAL && Options_Coerce_True(options)
+            ? FN_DETAIL_ALL : FN_DETAIL_NUMBER
+        );
+    }
+    else {
+        tokenize_number(
+            str, end, &token, FN_DETAIL_ALL,
+            OPTION(defaults, Options_Allow_Underscores(options), true)
+        );
+    }
+
+    switch (type) {
+    case FLOAT:
+        return token_to_float_result(
+                   &token,
+                   OPTION(defaults, Options_Exact_Floats(options), true)
+               );
+    case INT:
+        return token_to_int_result(&token);
+    case FORCEINT:
+    case INTLIKE:
+        /* Truncate a float straight from its digits, unless it is too
+         * large to be anything but INF as a float.
+         */
+        if ((token.kind == FN_FLOAT || token.kind == FN_INTLIKE_FLOAT)
+                && !number_token_overflows_double(&token)) {
+            return token_to_forced_int_result(&token);
+        }
+        break;
+    case REAL:
+        break;
+    }
+
     /* If the input contains an integer, convert to int directly. */
-    consume_sign(start);
-    if (string_contains_int(start, end, 10)) {
-        return str_to_PyInt(str, end, options);
+    if (token.kind == FN_INT) {
+        return token_to_int_result(&token);
     }
 
-    /* If not an int, assume the input is a float. */
-    pyresult = str_to_PyFloat(str, end, options);
-    if (pyresult == NULL) {
-        return NULL;
+    /* Coerce to int if needed, straight from the digits. Don't do it
+     * if the float would be INF.
+     */
+    if (OPTION(defaults, Options_Coerce_True(options), true)
+            && token.kind == FN_INTLIKE_FLOAT
+            && !number_token_overflows_double(&token)) {
+        return token_to_forced_int_result(&token);
     }
 
-    /* Coerce to int if needed. Don't do it for NAN or INF. */
-    return (Options_Coerce_True(options)
-            && string_contains_intlike_float(start, end)
-            && !PyNumber_IsNAN(pyresult)
-            && !PyNumber_IsINF(pyresult)
-           )
-           ? PyFloat_to_PyInt(pyresult, options)
-           : pyresult;
+    /* Otherwise the input is a float. */
+    return token_to_float_result(
+               &token,
+               OPTION(defaults, Options_Exact_Floats(options), true)
+           );
 }
 
 
-static PyObject *
-python_lib_str_to_PyFloat(const char *str, const Py_ssize_t len,
-                          const Options *options)
-{
-    const char *nend = (char *) str + len;
-    char *pend = (char *) nend;
-    double result;
-    result = PyOS_string_to_double(str, &pend, NULL);
-    /* Raise exception in the event of a memory error. */
-    if (errno == ENOMEM) {
-        return NULL;
+FN_INLINE(FnResult)
+token_to_float_result(const NumberToken *token, const bool exact)
+{
+    FnResult result;
+    result.sign = token->sign;
+    switch (token->kind) {
+    case FN_INFINITY:
+        result.status = FN_STATUS_INFINITY;
+        result.value.real = token->sign < 0 ? -Py_HUGE_VAL : Py_HUGE_VAL;
+        break;
+    case FN_NAN:
+        result.status = FN_STATUS_NAN;
+        result.value.real = signed_NaN(token->sign < 0);
+        break;
+    case FN_NOT_NUMBER:
+        return invalid_result();
+    default:
+        /* This is correctly rounded (unless speed was asked for
+         * instead), so there is never any need to fall back on
+         * Python's parser.
+         */
+        result.status = FN_STATUS_FLOAT;
+        result.value.real = number_token_to_double(token, exact);
+        break;
     }
-    if (pend == nend) {
-        return PyFloat_FromDouble(result);
+    return result;
+}
+
+
+/* Convert a scanned int. Anything else is invalid. */
+static FnResult
+token_to_int_result(const NumberToken *token)
+{
+    FnResult result;
+
+    if (token->kind != FN_INT) {
+        return invalid_result();
     }
-    /* Set error... The above won't because pend is non-NULL. Well, that
-     * statement isn't fully true... if not even the first digit could be
-     * converted then it would raise an error, but we are protected from
-     * that because of the is_likely_float heuristic.
+
+    /* Up to FN_MAX_MANTISSA_DIGITS significant digits, the
+     * mantissa is the value.
+     */
+    if (token->adjust == 0) {
+        result.status = FN_STATUS_INT;
+        result.sign = token->sign;
+        result.value.magnitude = token->mantissa;
+        return result;
+    }
+
+    /* Otherwise perform the actual parse. Underscores are skipped
+     * while scanning, so only an int that contains any needs its
+     * digits copied without them.
      */
-    if (Options_Should_Raise(options)) {
-        SET_ERR_INVALID_FLOAT(options);
+    if (token->int_underscores == 0) {
+        result = parse_int(token->int_start, token->int_end);
+        result.sign = token->sign;
+        return result;
     }
-    return NULL;
+    return digits_result(token->int_start, token->int_end,
+                         number_token_int_digits(token),
+                         token->int_end - token->int_start -
+                         token->int_underscores,
+                         token->sign);
 }
 
 
-static PyObject *
-str_to_PyFloat(const char *str, const char *end, const Options *options)
+/* Convert a finite float to an int, truncating any fraction. This is
+ * exact - unlike going through a double, which only has 53 bits of
+ * precision. A mantissa that holds all of the digits is scaled
+ * natively if the result fits in 64 bits; otherwise the integral
+ * digits are converted like an int.
+ */
+static FnResult
+token_to_forced_int_result(const NumberToken *token)
 {
-    const char *start = str;
-    const int8_t sign = consume_and_return_sign(start);
-    const Py_ssize_t len = end - start;
-    const Py_ssize_t real_len = end - str;
+    static const uint64_t powers_of_ten[] = {
+        UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000),
+        UINT64_C(10000), UINT64_C(100000), UINT64_C(1000000),
+        UINT64_C(10000000), UINT64_C(100000000), UINT64_C(1000000000),
+        UINT64_C(10000000000), UINT64_C(100000000000),
+        UINT64_C(1000000000000), UINT64_C(10000000000000),
+        UINT64_C(100000000000000), UINT64_C(1000000000000000),
+        UINT64_C(10000000000000000), UINT64_C(100000000000000000),
+        UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)
+    };
+    const Py_ssize_t ndigits = number_token_int_digits(token);
+    const int64_t q = (int64_t) token->expon + token->adjust;
+    FnResult result;
+    result.status = FN_STATUS_INT;
+    result.sign = token->sign;
 
-    /* Use some simple heuristics to determine if the the string
-     * is likely a float - first and last characters must be digits.
-     * Also quick detect NaN and INFINITY.
-     */
-    if (quick_detect_infinity(start, len)) {
-        if (Options_Has_INF_Sub(options)) {
-            return Options_Return_INF_Sub(options);
-        }
-        else {
-            Py_RETURN_INF(sign);
+    if (ndigits <= 0) {
+        result.value.magnitude = 0;
+        return result;
+    }
+    if (!token->truncated && ndigits <= FN_WORD_DIGITS) {
+        result.value.magnitude = q >= 0
+                                 ? token->mantissa * powers_of_ten[q]
+                                 : token->mantissa / powers_of_ten[-q];
+        return result;
+    }
+    return digits_result(token->int_start, token->frac_end, ndigits,
+                         ndigits, token->sign);
+}
+
+
+/* Convert an int in an explicit base (0 to detect it from the prefix).
+ * Ints that do not fit in 64 bits are left to Python's built-in parser,
+ * but only once they are known to be valid, which saves Python from
+ * building an exception (slow) just for us to throw it away.
+ */
+static FnResult
+based_int_result(const char *str, const char *end, const int base,
+                 const bool allow_underscores)
+{
+    const char *digits = str;
+    const int8_t sign = (int8_t) consume_and_return_sign(digits, end);
+    FnResult result = parse_int_in_base(digits, end, base,
+                                        allow_underscores);
+    if (result.status == FN_STATUS_LONG_INT) {
+        result.value.digits.start = str;  /* Sign and all, for Python. */
+    }
+    result.sign = sign;
+    return result;
+}
+
+
+/* Convert the first ndigits significant digits from start to stop
+ * (see FnDigits), of which there are length in all. If there are
+ * few enough they are copied out and converted here, otherwise the
+ * result only records where they are.
+ */
+static FnResult
+digits_result(const char *start, const char *stop, const Py_ssize_t ndigits,
+              const Py_ssize_t length, const int8_t sign)
+{
+    char digits[FN_MAX_INT_LEN];
+    FnResult result;
+    result.status = FN_STATUS_LONG_INT;
+
+    if (ndigits <= FN_MAX_INT_LEN) {
+        copy_int_digits(start, stop, digits, ndigits);
+        result = parse_int(digits, digits + ndigits);
+    }
+    if (result.status == FN_STATUS_LONG_INT) {
+        result.value.digits.start = start;
+        result.value.digits.end = stop;
+        result.value.digits.ndigits = ndigits;
+        result.value.digits.length = length;
+        result.value.digits.base = 10;
+    }
+    result.sign = sign;
+    return result;
+}
+
+
+/* A result for a string that is not a valid number of the type. */
+static FnResult
+invalid_result(void)
+{
+    FnResult result;
+    result.status = FN_STATUS_INVALID;
+    result.sign = 1;
+    return result;
+}
+
+
+/* Copy the first len significant digits from start to stop into out,
+ * skipping underscores and a decimal point, and padding with zeros if
+ * the digits run out.
+ */
+static void
+copy_int_digits(const char *start, const char *stop, char *out,
+                const Py_ssize_t len)
+{
+    const char *out_end = out + len;
+    bool leading = true;
+
+    for (; start != stop && out != out_end; start += 1) {
+        if (*start == '_' || *start == '.' || (leading && *start == '0')) {
+            continue;
         }
+        leading = false;
+        *out++ = *start;
     }
-    else if (quick_detect_nan(start, len)) {
-        if (Options_Has_NaN_Sub(options)) {
-            return Options_Return_NaN_Sub(options);
+    memset(out, '0', out_end - out);
+}
+
+
+/* Build the Python object for the result of parsing the string from
+ * str to end, or set the appropriate error (if raising) and return
+ * NULL. A float is then truncated for the int-only types.
+ */
+FN_INLINE(PyObject *)
+result_to_PyNumber(const FnResult *result, const char *str, const char *end,
+                   const PyNumberType type, const Options *options,
+                   const bool defaults)
+{
+    PyObject *pyresult = NULL;
+
+    switch (result->status) {
+    case FN_STATUS_INT:
+        return PyLong_from_fn_uint(result->value.magnitude, result->sign);
+    case FN_STATUS_LONG_INT:
+        return long_result_to_PyInt(result, str, end, options);
+    case FN_STATUS_INFINITY:
+        pyresult = OPTION(defaults, Options_Has_INF_Sub(options), false)
+                   ? Options_Return_INF_Sub(options)
+                   : PyFloat_FromDouble(result->value.real);
+        break;
+    case FN_STATUS_NAN:
+        pyresult = OPTION(defaults, Options_Has_NaN_Sub(options), false)
+                   ? Options_Return_NaN_Sub(options)
+                   : PyFloat_FromDouble(result->value.real);
+        break;
+    case FN_STATUS_FLOAT:
+        pyresult = PyFloat_FromDouble(result->value.real);
+        break;
+    case FN_STATUS_INVALID:
+        if (type == INT) {
+            SET_ERR_INVALID_INT(options);
         }
         else {
-            return PyFloat_from_NaN(sign < 0);
+            SET_ERR_INVALID_FLOAT(options);
         }
-    }
-    else if (!is_likely_float(start, len)) {
-        SET_ERR_INVALID_FLOAT(options);
         return NULL;
     }
 
-    /* Perform the actual parse using either the "fast" parser
-     * or Python's built-in parser. Pre-determine if the "fast"
-     * method might overflow based on the length of the string,
-     * and if it might stay on the safe side and go straight to
-     * Python's built-in version, otherwise use the "fast" version.
-     */
-    else if (float_might_overflow(start, len)) {
-        return python_lib_str_to_PyFloat(str, real_len, options);
+    /* If a float was returned, convert to an int. Otherwise return as-is. */
+    return (type == FORCEINT || type == INTLIKE) && pyresult != NULL
+           && PyFloat_Check(pyresult)
+           ? PyFloat_to_PyInt(pyresult, options)
+           : pyresult;
+}
+
+
+/* Convert an int too long to have been converted while parsing. Its
+ * digits (which have been validated) are copied out without anything
+ * else and converted by divide-and-conquer, unless they exceed the
+ * limit on the number of digits or are not decimal, in which case the
+ * string is handed to Python's built-in parser.
+ */
+static PyObject *
+long_result_to_PyInt(const FnResult *result, const char *str,
+                     const char *end, const Options *options)
+{
+    const FnDigits *digits = &result->value.digits;
+    char *copy = NULL;
+
+    if (digits->base != 10) {
+        return python_lib_str_to_PyInt(digits->start, digits->end,
+                                       digits->base, options);
     }
-    else {
-        bool error = false;
-        double result = parse_float(start, end, &error, sign);
-        if (error) {
-            SET_ERR_INVALID_FLOAT(options);
-            return NULL;
-        }
-        return PyFloat_FromDouble(result);
+    if (digits->length > FN_MAX_STR_DIGITS_THRESHOLD &&
+            !within_int_max_str_digits(digits->length)) {
+        return python_lib_str_to_PyInt(str, end, 10, options);
     }
+    if ((copy = scratch_reserve(digits->ndigits)) == NULL) {
+        return NULL;
+    }
+    copy_int_digits(digits->start, digits->end, copy, digits->ndigits);
+    return long_digits_to_PyInt(copy, copy + digits->ndigits, result->sign);
 }
 
 
@@ -146,10 +448,7 @@ handle_possible_conversion_error(const char *end, char *pend,
                                  PyObject *val, const Options *options)
 {
     /* If the expected end matches the parsed end, it was a success.
-     * This function includes trailing whitespace in "end" definition
-     * so we must do the same. */
-    consume_white_space(end);
-    /* If an error occurred, clear exception (if needed) and return NULL. */
+     * If an error occurred, clear exception (if needed) and return NULL. */
     if (val == NULL || pend != end) {
         if (pend != end && Options_Should_Raise(options)) {
             SET_ERR_INVALID_INT(options);
@@ -164,124 +463,309 @@ handle_possible_conversion_error(const char *end, char *pend,
 }
 
 
+/* Convert the int from str to end with Python's built-in parser.
+ * This needs a terminated string, so it is given a copy.
+ */
 static PyObject *
-str_to_PyInt(const char *str, const char *end, const Options *options)
+python_lib_str_to_PyInt(const char *str, const char *end, const int base,
+                        const Options *options)
 {
-    const char *start = str;
-    const long sign = consume_and_return_sign(start);
-    Py_ssize_t len = 0;
+    PyObject *copy = PyBytes_FromStringAndSize(str, end - str);
+    PyObject *num = NULL;
+    char *pend = NULL;
+    if (copy == NULL) {
+        return NULL;
+    }
+    pend = PyBytes_AS_STRING(copy) + PyBytes_GET_SIZE(copy);
+    num = PyLong_FromString(PyBytes_AS_STRING(copy), &pend, base);
+    num = handle_possible_conversion_error(
+              PyBytes_AS_STRING(copy) + PyBytes_GET_SIZE(copy), pend, num,
+              options
+          );
+    Py_DECREF(copy);
+    return num;
+}
 
-    /* Use some simple heuristics to determine if the the string
-     * is likely an int - first and last characters must be digits.
-     */
-    len = end - start;
-    if (!is_likely_int(start, len)) {
-        SET_ERR_INVALID_INT(options);
+
+/* Does an int with len digits fit within the limit set by
+ * sys.set_int_max_str_digits? If not, it is left to Python's
+ * parser to raise the appropriate error. A Python without the
+ * limit (or a limit of 0) accepts any length.
+ */
+static bool
+within_int_max_str_digits(const Py_ssize_t len)
+{
+    PyObject *get_limit = PySys_GetObject("get_int_max_str_digits");
+    PyObject *pylimit = NULL;
+    Py_ssize_t limit = 0;
+    if (get_limit == NULL) {
+        return true;
+    }
+    if ((pylimit = PyObject_CallObject(get_limit, NULL)) == NULL) {
+        PyErr_Clear();
+        return false;
+    }
+    limit = PyLong_AsSsize_t(pylimit);
+    Py_DECREF(pylimit);
+    if (limit == -1 && PyErr_Occurred()) {
+        PyErr_Clear();
+        return false;
+    }
+    return limit == 0 || len <= limit;
+}
+
+
+/* Convert a long string of (validated) decimal digits to a Python int.
+ * Up to FN_MAX_LIMBS_LEN digits are converted natively. Longer strings
+ * are split by divide-and-conquer at 10**(n * 2**k), where n is
+ * FN_MAX_LIMBS_LEN and the low part is the longest such block that
+ * leaves a non-empty high part; each part is converted in turn and
+ * they are combined as high * 10**(n * 2**k) + low. With CPython's
+ * Karatsuba multiplication this is subquadratic in the number of
+ * digits, whereas PyLong_FromString is quadratic.
+ */
+static PyObject *
+long_digits_to_PyInt(const char *str, const char *end, const long sign)
+{
+    const Py_ssize_t len = end - str;
+    uint64_t *limbs = NULL;
+    PyObject *powers[sizeof(Py_ssize_t) * CHAR_BIT] = {NULL};
+    PyObject *result = NULL;
+    size_t k;
+
+    /* Room for the longest block that is converted natively. */
+    limbs = scratch_reserve(
+                ((len < FN_MAX_LIMBS_LEN ? len : FN_MAX_LIMBS_LEN)
+                 / FN_WORD_DIGITS + 1) * sizeof(uint64_t)
+            );
+    if (limbs == NULL) {
         return NULL;
     }
+    result = digits_to_PyLong(str, end, limbs, powers);
+    for (k = 0; k < sizeof(powers) / sizeof(powers[0]); k++) {
+        Py_XDECREF(powers[k]);
+    }
 
-    /* Perform the actual parse using either the "fast" parser
-     * or Python's built-in parser. Pre-determine if the "fast"
-     * method might overflow based on the length of the string,
-     * and if it might stay on the safe side and go straight to
-     * Python's built-in version, otherwise use the "fast" version.
-     */
-    else if (int_might_overflow(start, end)) {
-        /* The way exception building for Python's built-in string->int
-         * conversion function is slow, because it allocates a unicode
-         * object just to put it into the traceback (rather than use the
-         * given input string, and there is no way to tell it to not
-         * build the traceback. For this reason we pre-validate to save
-         * time in the event of an error.
-         */
-        if (string_contains_int(start, end, 10)) {
-            char *pend = (char *)end;
-            PyObject *num = PyLong_FromString((char *) str, &pend, 10);
-            return handle_possible_conversion_error(end, pend, num, options);
+    if (result != NULL && sign < 0) {
+        Py_SETREF(result, PyNumber_Negative(result));
+    }
+    return result;
+}
+
+
+static PyObject *
+digits_to_PyLong(const char *str, const char *end, uint64_t *limbs,
+                 PyObject **powers)
+{
+    const Py_ssize_t len = end - str;
+    Py_ssize_t low_len = FN_MAX_LIMBS_LEN;
+    PyObject *power = NULL;
+    PyObject *high = NULL;
+    PyObject *low = NULL;
+    PyObject *result = NULL;
+    int k = 0;
+
+    if (len <= FN_MAX_LIMBS_LEN) {
+        return PyLong_from_limbs(limbs, parse_int_to_limbs(str, end, limbs));
+    }
+
+    while (2 * low_len < len) {
+        low_len *= 2;
+        k += 1;
+    }
+    if ((power = power_of_ten_blocks(k, powers)) == NULL) {
+        return NULL;
+    }
+    if ((high = digits_to_PyLong(str, end - low_len, limbs, powers)) == NULL) {
+        return NULL;
+    }
+    if ((low = digits_to_PyLong(end - low_len, end, limbs, powers)) == NULL) {
+        Py_DECREF(high);
+        return NULL;
+    }
+    if ((result = PyNumber_Multiply(high, power)) != NULL) {
+        Py_SETREF(result, PyNumber_Add(result, low));
+    }
+    Py_DECREF(high);
+    Py_DECREF(low);
+    return result;
+}
+
+
+/* Return 10**(FN_MAX_LIMBS_LEN * 2**k) (borrowed from powers),
+ * computing it by repeated squaring if needed. These are expensive to
+ * compute, so they are built lazily and kept in powers, but only for
+ * one conversion - Python objects cannot live in C statics, which every
+ * subinterpreter (or thread without a GIL) would share.
+ */
+static PyObject *
+power_of_ten_blocks(const int k, PyObject **powers)
+{
+    if (powers[k] == NULL) {
+        if (k == 0) {
+            PyObject *ten = PyLong_FromLong(10L);
+            PyObject *exponent = PyLong_FromLong(FN_MAX_LIMBS_LEN);
+            if (ten != NULL && exponent != NULL) {
+                powers[k] = PyNumber_Power(ten, exponent, Py_None);
+            }
+            Py_XDECREF(ten);
+            Py_XDECREF(exponent);
         }
         else {
-            SET_ERR_INVALID_INT(options);
-            return NULL;
+            PyObject *root = power_of_ten_blocks(k - 1, powers);
+            if (root != NULL) {
+                powers[k] = PyNumber_Multiply(root, root);
+            }
         }
     }
+    return powers[k];
+}
+
+
+/* Build a (non-negative) Python int from little-endian 64-bit limbs.
+ * The limbs are overwritten with their little-endian bytes.
+ */
+static PyObject *
+PyLong_from_limbs(uint64_t *limbs, const Py_ssize_t nlimbs)
+{
+    unsigned char *bytes = (unsigned char *) limbs;
+#if !PY_LITTLE_ENDIAN
+    register Py_ssize_t i;
+    register int j;
+    for (i = 0; i < nlimbs; i++) {
+        const uint64_t limb = limbs[i];
+        for (j = 0; j < 8; j++) {
+            bytes[i * 8 + j] = (unsigned char) (limb >> (8 * j));
+        }
+    }
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    return PyLong_FromUnsignedNativeBytes(
+               bytes, nlimbs * 8,
+               Py_ASNATIVEBYTES_LITTLE_ENDIAN |
+               Py_ASNATIVEBYTES_UNSIGNED_BUFFER
+           );
+#else
+    return _PyLong_FromByteArray(bytes, nlimbs * 8, 1, 0);
+#endif
+}
+
+
+/* Build a Python int from a magnitude and sign. Anything that does
+ * not fit in a long long goes through the bytes of a two's-complement
+ * 128-bit integer (negating cannot overflow with at most 38 digits).
+ */
+static PyObject *
+PyLong_from_fn_uint(const fn_uint_t value, const long sign)
+{
+    if (value <= (fn_uint_t) LLONG_MAX) {
+        return PyLong_FromLongLong(sign * (long long) value);
+    }
+    else if (sign > 0 && value <= (fn_uint_t) UINT64_MAX) {
+        return PyLong_FromUnsignedLongLong((unsigned long long) value);
+    }
     else {
-        bool error = false;
-        long result = parse_int(start, end, &error);
-        if (error) {
-            SET_ERR_INVALID_INT(options);
+#if FN_HAVE_INT128
+        const __int128 signed_value = sign * (__int128) value;
+#if PY_VERSION_HEX >= 0x030D0000
+        return PyLong_FromNativeBytes(&signed_value, sizeof(signed_value), -1);
+#else
+        return _PyLong_FromByteArray((const unsigned char *) &signed_value,
+                                     sizeof(signed_value), PY_LITTLE_ENDIAN,
+                                     1);
+#endif
+#else
+        /* Only -(LLONG_MAX + 1) to -UINT64_MAX end up here. */
+        PyObject *magnitude = PyLong_FromUnsignedLongLong(value);
+        PyObject *negated = NULL;
+        if (magnitude == NULL) {
             return NULL;
         }
-        return PyLong_FromLong(sign * result);
+        negated = PyNumber_Negative(magnitude);
+        Py_DECREF(magnitude);
+        return negated;
+#endif
     }
 }
 
 
-static PyObject *
-str_to_PyInt_forced(const char *str, const char *end,
-                    const Options *options)
+/* How many digits the integral part of a (finite) float has, which
+ * is zero or less if it is less than one. Only the leading digits of
+ * a long mantissa are kept, so this counts those plus the scale.
+ */
+static Py_ssize_t
+number_token_int_digits(const NumberToken *token)
 {
-    /* Convert the input to an int or float. */
-    PyObject *pyresult = str_to_PyInt_or_PyFloat(str, end, options);
-    if (pyresult == NULL) {
-        return NULL;
+    uint64_t mantissa = token->mantissa;
+    int64_t ndigits = (int64_t) token->expon + token->adjust;
+    if (mantissa == 0) {
+        return 0;
     }
+    for (; mantissa != 0; mantissa /= 10) {
+        ndigits += 1;
+    }
+    /* Anything longer is not finite as a double anyway. */
+    return ndigits > PY_SSIZE_T_MAX ? PY_SSIZE_T_MAX : (Py_ssize_t) ndigits;
+}
 
-    /* If a float was returned, convert to an int. Otherwise return as-is. */
-    return PyFloat_Check(pyresult)
-           ? PyFloat_to_PyInt(pyresult, options)
-           : pyresult;
+
+/* Is a float too large to be anything but INF as a double? Only a
+ * float that is about as large as DBL_MAX needs to be converted to
+ * find out.
+ */
+static bool
+number_token_overflows_double(const NumberToken *token)
+{
+    const Py_ssize_t ndigits = number_token_int_digits(token);
+    if (ndigits <= DBL_MAX_10_EXP) {
+        return false;
+    }
+    if (ndigits > DBL_MAX_10_EXP + 2) {
+        return true;
+    }
+    return Py_IS_INFINITY(number_token_to_double(token, true));
 }
 
 
-/* Run through the unicode and replace unicode decimals with
- * ASCII decimals, and replace weird whitespace with ASCII whitespace.
- * The returned char * WILL need to be freed at a later time.
+/* Run through the unicode from start to stop and replace unicode
+ * decimals with ASCII decimals, and replace weird whitespace with
+ * ASCII whitespace. The result is in scratch space.
  * If NULL is returned then a some sort of memory error occurred or
  * the data is invalid - it depends on the value of error.
- * If an error occurred, you will not need to free the result.
  */
 static char *
-PyUnicode_as_ascii_string(PyObject *obj, Py_ssize_t *len, bool *error)
+PyUnicode_as_ascii_string(PyObject *obj, const Py_ssize_t start,
+                          const Py_ssize_t stop, bool *error)
 {
     const int kind = PyUnicode_KIND(obj);  /* Unicode storage format. */
     const void *data = PyUnicode_DATA(obj);  /* Raw data */
     char *ascii = NULL;
     *error = false;
-    *len = PyUnicode_GET_LENGTH(obj);
 
-    /* It is assumed PyUnicode_Check has already been called. */
-    if (PyUnicode_READY(obj)) {  /* If true, then not OK for conversion. */
-        return NULL;
-    }
-
-    /* Allocate space for the new string. */
-    if ((ascii = calloc(*len + 1, sizeof(char))) == NULL) {
-        PyErr_NoMemory();
-        errno = ENOMEM;
+    /* Reserve space for the new string. */
+    if ((ascii = scratch_reserve(stop - start)) == NULL) {
         return NULL;
     }
     else {
         register Py_ssize_t i;
         register long n;
         register Py_UCS4 c;
-        register const Py_ssize_t size = *len;
 
         /* Convert each character. If a character is out of range then
          * quit and set the error flag.
          */
-        for (i = 0; i < size; i++) {
+        for (i = start; i < stop; i++) {
             c = PyUnicode_READ(kind, data, i);
             if (c < 127) {
-                ascii[i] = (char) c;
+                ascii[i - start] = (char) c;
             }
             else if ((n = Py_UNICODE_TODECIMAL(c)) > -1) {
-                ascii[i] = '0' + (char) n;
+                ascii[i - start] = '0' + (char) n;
             }
             else if (Py_UNICODE_ISSPACE(c)) {
-                ascii[i] = ' ';
+                ascii[i - start] = ' ';
             }
             else {
-                free(ascii);
                 *error = true;
                 return NULL;
             }
@@ -291,123 +775,105 @@ PyUnicode_as_ascii_string(PyObject *obj, Py_ssize_t *len, bool *error)
 }
 
 
-/* In a generic number, valid underscores are between two digits.
- * A "based" number is necessarily an int, and in those cases the
- * definition of a valid underscore is a bit less well-defined.
- * If NULL is returned an unrecoverable memory error occurred.
+/* Get the characters of unicode that is not compact ASCII without
+ * any leading or trailing (possibly non-ASCII) whitespace. If they
+ * are all ASCII they are used in place for one-byte unicode, or
+ * narrowed into the narrow buffer (FN_NARROW_BUFFER_LEN characters)
+ * or if they do not fit, scratch space for two-byte unicode. The
+ * characters are not terminated. Otherwise (and always for four-byte
+ * unicode, which cannot be ASCII once stripped) they are transcoded
+ * by PyUnicode_as_ascii_string, with the same results.
  */
 static const char *
-remove_valid_underscores(char *str, const char **end, char **buffer,
-                         const Py_ssize_t len, const bool based)
+PyUnicode_as_narrow_string(PyObject *obj, Py_ssize_t *len, char *narrow,
+                           bool *error)
 {
-    register Py_ssize_t i, offset;
+    int kind;
+    const void *data;
+    Py_ssize_t start = 0;
+    Py_ssize_t stop = 0;
+    char *dst = narrow;
+    *error = false;
 
-    /* If a buffer has not been created, do so now and copy data to it. */
-    if (*buffer == NULL) {
-        if ((*buffer = calloc(len + 1, sizeof(char))) == NULL) {
-            PyErr_NoMemory();
-            errno = ENOMEM;
-            return NULL;
-        }
-        memcpy(*buffer, str, len);
-        str = *buffer;
+    /* It is assumed PyUnicode_Check has already been called. */
+    if (PyUnicode_READY(obj)) {  /* If true, then not OK for conversion. */
+        return NULL;
     }
+    kind = PyUnicode_KIND(obj);
+    data = PyUnicode_DATA(obj);
+    stop = PyUnicode_GET_LENGTH(obj);
 
-    /* The method that will be used to remove underscores is to
-     * traverse the character array, and when a valid underscore
-     * is found all characters will be shifted one to the left in
-     * order to remove that underscore. Extra characters at the
-     * end of the character array will be overwritten with \0.
-     */
-
-    /* For non-based strings, parsing is "simple" -
-     * a valid underscore is surrounded by two numbers.
-     */
-    if (!based) {
-        for (i = offset = 0; i < len; i++) {
-            if (str[i] == '_' && i > 0 && i < len - 1 &&
-                    is_valid_digit_char(str[i - 1]) &&
-                    is_valid_digit_char(str[i + 1])) {
-                offset += 1;
-                continue;
-            }
-            if (offset) {
-                str[i - offset] = str[i];
-            }
-        }
+    /* Strip whitespace from both ends of the data. */
+    while (start < stop &&
+            Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, start))) {
+        start += 1;
     }
+    while (stop > start &&
+            Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, stop - 1))) {
+        stop -= 1;
+    }
+    *len = stop - start;
 
-    /* For based strings we must incorporate some state at the
-     * beginning of the string before the more simple "surrounded
-     * by two numbers" algorithm kicks in.
-     */
-    else {
-        i = offset = 0;
-        if (is_sign(str)) {
-            i += 1;
-        }
-        /* Skip leading characters for non-base 10 ints. */
-        if ((len - i) > 1 && str[i] == '0' &&
-                (((str[i + 1] == 'x' || str[i + 1] == 'X')) ||
-                 ((str[i + 1] == 'o' || str[i + 1] == 'O')) ||
-                 ((str[i + 1] == 'b' || str[i + 1] == 'B')))) {
-            /* An underscore after the prefix is allowed, e.g. 0x_d4. */
-            if ((len - i > 2) && str[i + 2] == '_') {
-                i += 3;
-                offset += 1;
-            }
-            else {
-                i += 2;
-            }
+    if (kind == PyUnicode_1BYTE_KIND) {
+        const char *str = (const char *) PyUnicode_1BYTE_DATA(obj) + start;
+        if (is_ascii(str, *len)) {
+            return str;
         }
-        /* No underscore in the base selector, e.g. 0_b0 is invalid. */
-        else if ((len - i) > 2 && str[i] == '0' && str[i + 1] == '_' &&
-                 (((str[i + 2] == 'x' || str[i + 2] == 'X')) ||
-                  ((str[i + 2] == 'o' || str[i + 2] == 'O')) ||
-                  ((str[i + 2] == 'b' || str[i + 2] == 'B')))) {
-            i += 3;
+    }
+    else if (kind == PyUnicode_2BYTE_KIND) {
+        if (*len > FN_NARROW_BUFFER_LEN &&
+                (dst = scratch_reserve(*len)) == NULL) {
+                return NULL;
         }
-
-        /* Now search for simpler valid underscores.
-         * use hex as the base because it is the most inclusive.
-         */
-        for (; i < len; i++) {
-            if (str[i] == '_' && i > 0 && i < len - 1 &&
-                    is_valid_digit_arbitrary_base(str[i - 1], 16) &&
-                    is_valid_digit_arbitrary_base(str[i + 1], 16)) {
-                offset += 1;
-                continue;
-            }
-            if (offset) {
-                str[i - offset] = str[i];
-            }
+        if (kernels->narrow_ucs2(PyUnicode_2BYTE_DATA(obj) + start,
+                                 *len, dst)) {
+            return dst;
         }
     }
 
-    /* Update the end position. */
-    *end = str + (i - offset);
+    /* Only non-ASCII digits (or invalid characters) get here. */
+    return PyUnicode_as_ascii_string(obj, start, stop, error);
+}
+
 
-    /* Fill the trailing data with nul characters. */
-    for (i = len - offset; i < len; i++) {
-        str[i] = '\0';
+/* Are the len characters at str all ASCII? Eight are checked at
+ * a time for all but the last few.
+ */
+static bool
+is_ascii(const char *str, const Py_ssize_t len)
+{
+    register Py_ssize_t i = 0;
+    register uint64_t seen = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, str + i, sizeof(chunk));
+        seen |= chunk;
     }
-    return str;
+    for (; i < len; i++) {
+        seen |= (unsigned char) str[i];
+    }
+    return (seen & UINT64_C(0x8080808080808080)) == 0;
 }
 
 
 /* Try to convert the Python object to bytes (i.e. char*).
  * Possibly convert unicode to bytes object first.
- * If the string contains nul characters, return "\0".
+ * The characters run up to end, and are not necessarily terminated.
+ * Anything this needed to hold on to (scratch space past the mark,
+ * or a view of a buffer object) must be released by calling
+ * release_PyString_str once the characters are no longer needed,
+ * unless NULL was returned. Whitespace is stripped from both ends
+ * unless strip is false (it always is for non-ASCII unicode).
  */
 static const char *
-convert_PyString_to_str(PyObject *input, const char **end,
-                        char **buffer, bool *must_raise, const bool based,
-                        const bool allow_underscores)
+convert_PyString_to_str(PyObject *input, const bool strip, const char **end,
+                        char *narrow, ScratchMark *mark, Py_buffer *view,
+                        bool *must_raise)
 {
     const char *str = NULL;
     Py_ssize_t len = 0;
-    Py_buffer view = {NULL, NULL}; /* Reference to a buffer object */
-    *buffer = NULL;
+    scratch_mark(mark);
+    view->obj = NULL;
     *must_raise = false;
 
     /* If the input was in unicode format, extract as ASCII if we can. */
@@ -420,15 +886,13 @@ convert_PyString_to_str(PyObject *input, const char **end,
         else
         {
             bool has_error = false;
-            *buffer = PyUnicode_as_ascii_string(input, &len, &has_error);
-            if (has_error) {
-                return NULL;  /* Buffer is always NULL if here. */
-            }
-            if (*buffer == NULL) {
-                *must_raise = true;
+            str = PyUnicode_as_narrow_string(input, &len, narrow,
+                                             &has_error);
+            if (str == NULL) {
+                *must_raise = !has_error;
+                scratch_release(mark);
                 return NULL;
             }
-            str = *buffer;
         }
     }
 
@@ -446,212 +910,327 @@ convert_PyString_to_str(PyObject *input, const char **end,
         len = PyByteArray_GET_SIZE(input);
     }
 
-    /* For a buffer, access the raw data in the buffer directly. */
+    /* For a buffer, access the raw data in the buffer directly. This
+     * could be a slice of a memoryview (or mmap), so is not terminated,
+     * which the parsers do not need. The view is held until the data
+     * has been parsed, since the exporter may only keep it alive
+     * until then.
+     */
     else if (PyObject_CheckBuffer(input) &&
-             PyObject_GetBuffer(input, &view, PyBUF_SIMPLE) == 0) {
-        /* This buffer could be a memoryview slice. If this is the case, the
-         * nul termination of the string wil be past the given length, creating
-         * unexpected parsing results. Rather than complicate the parsing and
-         * adding more operations for a low probability event, a copy of the
-         * slice will be made here and it will be implicitly nul terminated
-         * by the use of calloc.
-         */
-        if ((*buffer = calloc(view.len + 1, sizeof(char))) == NULL) {
-            PyErr_NoMemory();
-            errno = ENOMEM;
-            *must_raise = true;
-            return NULL;
-        }
-        memcpy(*buffer, (char *) view.buf, view.len);
-        str = *buffer;
-        len = view.len;
-        /* All we care about is the underlying buffer data, not the obj
-         * which was allocated when we created the buffer. For this reason
-         * it is safe to release the buffer here.
-         */
-        PyBuffer_Release(&view);
+             PyObject_GetBuffer(input, view, PyBUF_SIMPLE) == 0) {
+        str = (const char *) view->buf;
+        len = view->len;
     }
 
     /* Return NULL if data type was invalid. */
     if (str == NULL) {
-        free(*buffer);  /* Just in case */
         return NULL;
     }
 
-    /* Pre-process the input, first by stripping whitespace. */
-    strip_whitespace(str, *end, len);
-    len = *end - str;
-
-    /* Remove all "valid" underscores from the
-     * string to simplify downstream parsing.
+    /* Pre-process the input by stripping whitespace. Underscores
+     * are left for the parsers to skip.
      */
-    if (allow_underscores && len > 0 && memchr(str, '_', len)) {
-        if ((str = remove_valid_underscores((char *)str,
-                                            end, buffer,
-                                            len, based)) == NULL) {
-            *must_raise = true;
-            free(*buffer);
-            return NULL;
-        }
+    if (strip) {
+        strip_whitespace(str, *end, len);
+    }
+    else {
+        *end = str + len;
     }
-
     return str;
 }
 
 
-/* Convert numbers in strings. */
-PyObject *
-PyString_to_PyNumber(PyObject *obj, const PyNumberType type,
-                     const Options *options)
+/* Release what convert_PyString_to_str held on to. */
+static void
+release_PyString_str(const ScratchMark *mark, Py_buffer *view)
+{
+    scratch_release(mark);
+    if (view->obj != NULL) {
+        PyBuffer_Release(view);
+    }
+}
+
+
+/* Convert numbers in strings. This is compiled both for any options,
+ * and for each type with the default options, where defaults is true
+ * and every option is a constant (see PyString_to_PyNumber). Returns
+ * 1 with the number (or NULL for the caller to handle an invalid
+ * number) in pyresult, 0 if obj is not a string, or -1 with an
+ * exception set.
+ */
+FN_INLINE(int)
+string_to_number(PyObject *obj, const PyNumberType type,
+                 const Options *options, const bool defaults,
+                 PyObject **pyresult)
 {
     const char *end;
-    PyObject *pyresult = Py_None;  /* None indicates TypeError, not ValueError. */
+    const bool default_base = OPTION(defaults, Options_Default_Base(options),
+                                     true);
+    const bool trusted = OPTION(defaults, Options_Trusted(options), false) &&
+                         (type != INT || default_base || options->base == 10);
     bool needs_raise = false;
-    char *buf = NULL;
-    const char *str = convert_PyString_to_str(obj, &end, &buf, &needs_raise,
-                                              !Options_Default_Base(options),
-                                              Options_Allow_Underscores(options));
+    char narrow[FN_NARROW_BUFFER_LEN];
+    ScratchMark mark;
+    Py_buffer view;
+    const char *str = convert_PyString_to_str(obj, !trusted, &end, narrow,
+                                              &mark, &view, &needs_raise);
     if (needs_raise) {
-        /* Never need to free buffer if needs_raise is true. */
-        return NULL;
+        /* Nothing to release if needs_raise is true. */
+        return -1;
+    }
+    if (str == NULL) {
+        /* Not a string. Nothing to release if str was NULL. */
+        return 0;
+    }
+
+    /* To maintain compatibility with Python,
+     * explicit base MUST be a string-like type.
+     */
+    if (type == INT && !default_base && !STRING_TYPE_CHECK(obj)) {
+        SET_ILLEGAL_BASE_ERROR(options);
+        *pyresult = NULL;
+    }
+    else {
+        const FnResult result = chars_to_result(str, end, type, options,
+                                                defaults);
+        *pyresult = result_to_PyNumber(&result, str, end, type, options,
+                                       defaults);
+    }
+
+    release_PyString_str(&mark, &view);
+    return *pyresult == NULL && PyErr_Occurred() ? -1 : 1;
+}
+
+
+
+/* The conversions with the default options, one for each type. */
+#define define_default_conversion(name, type) \
+    static int \
+    name(PyObject *obj, const Options *options, PyObject **result) \
+    { \
+        return string_to_number(obj, type, options, true, result); \
     }
 
-    /* If we could extract the string, convert it! */
-    if (str != NULL) {
+define_default_conversion(string_to_real_default, REAL)
+define_default_conversion(string_to_float_default, FLOAT)
+define_default_conversion(string_to_int_default, INT)
+define_default_conversion(string_to_forceint_default, FORCEINT)
+
+
+/* Convert numbers in strings. Most calls give no options, so those go
+ * to a conversion that was compiled knowing that; anything else goes to
+ * the one that checks every option.
+ */
+int
+PyString_to_PyNumber(PyObject *obj, const PyNumberType type,
+                     const Options *options, PyObject **result)
+{
+    if (Options_Default_Conversion(options)) {
         switch (type) {
         case REAL:
-            pyresult = str_to_PyInt_or_PyFloat(str, end, options);
-            break;
+            return string_to_real_default(obj, options, result);
         case FLOAT:
-            pyresult = str_to_PyFloat(str, end, options);
-            break;
+            return string_to_float_default(obj, options, result);
         case INT:
-            /* To maintain compatibility with Python,
-             * explicit base MUST be a string-like type.
-             */
-            if (!Options_Default_Base(options) && !STRING_TYPE_CHECK(obj))
-            {
-                SET_ILLEGAL_BASE_ERROR(options);
-                pyresult = NULL;
-            }
-            else if (Options_Default_Base(options) || options->base == 10) {
-                pyresult = str_to_PyInt(str, end, options);
-            }
-            else {
-                char *pend = "\0";
-                pyresult = PyLong_FromString((char *) str, &pend, options->base);
-                pyresult = handle_possible_conversion_error(end, pend,
-                                                            pyresult,
-                                                            options);
-            }
-            break;
+            return string_to_int_default(obj, options, result);
         case FORCEINT:
+            return string_to_forceint_default(obj, options, result);
         case INTLIKE:
-            pyresult = str_to_PyInt_forced(str, end, options);
             break;
         }
     }
+    return string_to_number(obj, type, options, false, result);
+}
 
-    free(buf);
-    return pyresult;
+
+/* Get the characters of a string whose characters can be read without
+ * holding the GIL - an exact str of compact ASCII, or exact bytes, both
+ * of which are immutable and convert_PyString_to_str reads in place -
+ * stripped as PyString_to_PyNumber would. Returns NULL for anything
+ * else, without setting an exception.
+ */
+const char *
+PyString_stable_chars(PyObject *obj, const PyNumberType type,
+                      const Options *options, const char **end)
+{
+    const char *str = NULL;
+    Py_ssize_t len = 0;
+
+    if (PyUnicode_CheckExact(obj) && PyUnicode_IS_READY(obj) &&
+            PyUnicode_IS_COMPACT_ASCII(obj)) {
+        str = (const char *) PyUnicode_1BYTE_DATA(obj);
+        len = PyUnicode_GET_LENGTH(obj);
+    }
+    else if (PyBytes_CheckExact(obj)) {
+        str = PyBytes_AS_STRING(obj);
+        len = PyBytes_GET_SIZE(obj);
+    }
+    else {
+        return NULL;
+    }
+
+    if (Options_Trusted(options) && (type != INT ||
+                                     Options_Default_Base(options) ||
+                                     options->base == 10)) {
+        *end = str + len;
+    }
+    else {
+        strip_whitespace(str, *end, len);
+    }
+    return str;
 }
 
 
-/* Detect numbers in strings. */
+/* Parse characters from PyString_stable_chars. This uses no Python
+ * objects, so may be called without holding the GIL.
+ */
+FnResult
+string_to_result(const char *str, const char *end, const PyNumberType type,
+                 const Options *options)
+{
+    return chars_to_result(str, end, type, options, false);
+}
+
+
+/* Build the number for what string_to_result returned, while holding
+ * the GIL again. Returns NULL for an invalid number, with an exception
+ * set only if raising (or on a more serious error).
+ */
 PyObject *
+PyString_result_to_PyNumber(const FnResult *result, const char *str,
+                            const char *end, const PyNumberType type,
+                            const Options *options)
+{
+    PyObject *pyresult = NULL;
+    ScratchMark mark;
+    scratch_mark(&mark);
+    pyresult = result_to_PyNumber(result, str, end, type, options, false);
+    scratch_release(&mark);
+    return pyresult;
+}
+
+
+/* Detect numbers in strings. Returns 1 with the answer in result, 0
+ * if obj is not a string, or -1 with an exception set.
+ */
+int
 PyString_is_number(PyObject *obj, const PyNumberType type,
-                   const Options *options)
+                   const Options *options, bool *result)
 {
     const char *end;
     const int base = Options_Default_Base(options) ? 10 : options->base;
-    bool result = false, needs_raise = false;
-    char *buf = NULL;
-    const char *str = convert_PyString_to_str(obj, &end, &buf, &needs_raise,
-                                              !Options_Default_Base(options),
-                                              Options_Allow_Underscores(options));
+    bool needs_raise = false;
+    char narrow[FN_NARROW_BUFFER_LEN];
+    ScratchMark mark;
+    Py_buffer view;
+    const char *str = convert_PyString_to_str(obj, true, &end, narrow,
+                                              &mark, &view, &needs_raise);
     if (needs_raise) {
-        /* Never need to free buffer if needs_raise is true. */
-        return NULL;
-    }
-
-    if (str != NULL) {
-        consume_sign(str);  /* All functions require sign is stripped. */
-        switch (type) {
-        case REAL:
-        case FLOAT:
-            result = string_contains_float(str, end,
-                                           Options_Allow_Infinity(options),
-                                           Options_Allow_NAN(options));
-            break;
-        case INT:
-            result = string_contains_int(str, end, base);
-            break;
-        case FORCEINT:
-        case INTLIKE:
-            result = string_contains_intlike_float(str, end);
-            break;
-        }
+        /* Nothing to release if needs_raise is true. */
+        return -1;
     }
-    else {
-        /* Not a string. Never need to free if str was NULL. */
-        return Py_None;
+    if (str == NULL) {
+        /* Not a string. Nothing to release if str was NULL. */
+        return 0;
     }
 
-    free(buf);
-    if (result) {
-        Py_RETURN_TRUE;
+    if (type == INT) {
+        /* Only the digits matter, so there is nothing to record. */
+        consume_sign(str, end);  /* string_contains_int requires no sign. */
+        *result = string_contains_int(str, end, base,
+                                      Options_Allow_Underscores(options));
     }
     else {
-        Py_RETURN_FALSE;
+        NumberToken token;
+        tokenize_number(str, end, &token,
+                        type == INTLIKE ? FN_DETAIL_KIND : FN_DETAIL_NUMBER,
+                        Options_Allow_Underscores(options));
+        *result = token_is_type(&token, type, options);
     }
+
+    release_PyString_str(&mark, &view);
+    return 1;
 }
 
 
-/* Return the type contained the string. */
-PyObject *
-PyString_contains_type(PyObject *obj, const Options *options)
+/* Find the type contained in the string. Returns 1 with a new reference
+ * to the type in result, 0 if obj is not a string, or -1 with an
+ * exception set.
+ */
+int
+PyString_contains_type(PyObject *obj, const Options *options,
+                       PyObject **result)
 {
     const char *end;
     const int base = Options_Default_Base(options) ? 10 : options->base;
-    PyObject *result = NULL;
     bool needs_raise = false;
-    char *buf = NULL;
-    const char *str = convert_PyString_to_str(obj, &end, &buf, &needs_raise,
-                                              !Options_Default_Base(options),
-                                              Options_Allow_Underscores(options));
+    char narrow[FN_NARROW_BUFFER_LEN];
+    ScratchMark mark;
+    Py_buffer view;
+    NumberToken token;
+    bool is_int = false;
+    const char *str = convert_PyString_to_str(obj, true, &end, narrow,
+                                              &mark, &view, &needs_raise);
     if (needs_raise) {
-        /* Never need to free buffer if needs_raise is true. */
-        return NULL;
+        /* Nothing to release if needs_raise is true. */
+        return -1;
+    }
+    if (str == NULL) {
+        /* Not a string. Nothing to release if str was NULL. */
+        return 0;
     }
 
-    if (str != NULL) {
-        consume_sign(str);  /* All functions require sign is stripped. */
-        if (string_contains_int(str, end, base)) {
-            result = (PyObject *) &PyLong_Type;
-            Py_INCREF(result);
-        }
-        else if (Options_Coerce_True(options) &&
-                 string_contains_intlike_float(str, end))
-        {
-            result = (PyObject *) &PyLong_Type;
-            Py_INCREF(result);
-        }
-        else if (string_contains_float(str, end,
-                                       Options_Allow_Infinity(options),
-                                       Options_Allow_NAN(options)))
-        {
-            result = (PyObject *) &PyFloat_Type;
-            Py_INCREF(result);
-        }
-        else {
-            result = PyObject_Type(obj);
-        }
+    tokenize_number(str, end, &token,
+                    Options_Coerce_True(options) ? FN_DETAIL_KIND
+                                                 : FN_DETAIL_NUMBER,
+                    Options_Allow_Underscores(options));
+    if (base == 10) {
+        is_int = token.kind == FN_INT;
     }
     else {
-        /* Not a string. Never need to free if str was NULL. */
-        return Py_None;
+        consume_sign(str, end);  /* string_contains_int requires no sign. */
+        is_int = string_contains_int(str, end, base,
+                                     Options_Allow_Underscores(options));
     }
 
-    free(buf);
-    return result;
-}
\ No newline at end of file
+    if (is_int || (Options_Coerce_True(options) &&
+                   token_is_type(&token, INTLIKE, options))) {
+        *result = (PyObject *) &PyLong_Type;
+        Py_INCREF(*result);
+    }
+    else if (token_is_type(&token, FLOAT, options)) {
+        *result = (PyObject *) &PyFloat_Type;
+        Py_INCREF(*result);
+    }
+    else {
+        *result = PyObject_Type(obj);
+    }
+
+    release_PyString_str(&mark, &view);
+    return *result == NULL ? -1 : 1;
+}
+
+
+/* Does a scanned string contain the given type of number?
+ * Any int or float is a float, any int is int-like.
+ */
+static bool
+token_is_type(const NumberToken *token, const PyNumberType type,
+              const Options *options)
+{
+    switch (token->kind) {
+    case FN_INT:
+        return true;
+    case FN_INTLIKE_FLOAT:
+        return type != INT;
+    case FN_FLOAT:
+        return type == REAL || type == FLOAT;
+    case FN_INFINITY:
+        return (type == REAL || type == FLOAT) &&
+               Options_Allow_Infinity(options);
+    case FN_NAN:
+        return (type == REAL || type == FLOAT) && Options_Allow_NAN(options);
+    default:
+        return false;
+    }
+}
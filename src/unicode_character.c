@@ -11,63 +11,139 @@
 #include "fastnumbers/unicode_character.h"
 #include "fastnumbers/numbers.h"
 #include "fastnumbers/options.h"
+#include "fastnumbers/tables.h"
 
-/* Obtain a PyLong or PyFloat from this unicode string assuming
- * it is a single unicode non-decimal numeric character.
- * Return NULL if not possible. Return Py_None not PyUnicode.
+/* What a (possibly signed) single unicode character was found to be. */
+typedef enum UnicodeCharacterKind {
+    FN_UNICODE_NOT_UNICODE,
+    FN_UNICODE_INVALID,
+    FN_UNICODE_NUMBER,
+} UnicodeCharacterKind;
+
+
+/* Forward declarations */
+static bool
+lookup_numeric(const Py_UCS4 u, UnicodeNumeric *number);
+static UnicodeCharacterKind
+parse_unicode_character(PyObject *input, UnicodeNumeric *number);
+static PyObject *
+UnicodeNumeric_to_PyNumber(const UnicodeNumeric *number);
+
+
+/* Find the numeric value of a character in the generated table (see
+ * dev/generate_tables.py). Characters that were unassigned in the
+ * Unicode version the table was made from may have a value in the
+ * version of the running Python, so only those are looked up in
+ * CPython's own (slower) tables. Return false if not numeric.
  */
-PyObject *
-convert_PyUnicode_to_PyNumber(PyObject *input)
+static bool
+lookup_numeric(const Py_UCS4 u, UnicodeNumeric *number)
+{
+    const unsigned block = fn_unicode_numeric_block[u >> FN_UNICODE_BLOCK_SHIFT];
+    const unsigned offset = u & ((1u << FN_UNICODE_BLOCK_SHIFT) - 1);
+    const unsigned cls =
+        fn_unicode_numeric_class[(block << FN_UNICODE_BLOCK_SHIFT) | offset];
+
+    if (cls >= FN_UNICODE_FIRST_NUMERIC) {
+        *number = fn_unicode_numeric_value[cls - FN_UNICODE_FIRST_NUMERIC];
+        return true;
+    }
+    else if (cls == FN_UNICODE_UNASSIGNED) {
+        const double value = Py_UNICODE_TONUMERIC(u);
+        if (value > -1.0) {
+            number->value = value;
+            number->is_int = Py_UNICODE_TODIGIT(u) > -1;
+            number->is_intlike = value == (double) (int64_t) value;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Find the value of this unicode string assuming it is a single
+ * unicode numeric character, with optional sign and whitespace.
+ */
+static UnicodeCharacterKind
+parse_unicode_character(PyObject *input, UnicodeNumeric *number)
 {
-    const int kind = PyUnicode_KIND(input);  /* Unicode storage format. */
-    const void *data = PyUnicode_DATA(input);  /* Raw data */
-    Py_ssize_t len = PyUnicode_GET_LENGTH(input);
+    int kind;
+    const void *data;
+    Py_ssize_t len;
     Py_ssize_t index = 0;
     bool negative = false;
 
     /* Ensure input is a valid unicode object. */
     if (!PyUnicode_Check(input)) {
-        return Py_None;
+        return FN_UNICODE_NOT_UNICODE;
     }
     if (PyUnicode_READY(input)) {  /* If true, then not OK for conversion. */
-        return Py_None;
+        return FN_UNICODE_NOT_UNICODE;
     }
+    kind = PyUnicode_KIND(input);  /* Unicode storage format. */
+    data = PyUnicode_DATA(input);  /* Raw data */
+    len = PyUnicode_GET_LENGTH(input);
 
     /* Strip whitespace from both ends of the data. */
-    while (Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, index))) {
+    while (len > 0 && Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, index))) {
         index += 1;
         len -= 1;
     }
-    while (Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, index + len - 1))) {
+    while (len > 0 &&
+           Py_UNICODE_ISSPACE(PyUnicode_READ(kind, data, index + len - 1))) {
         len -= 1;
     }
 
     /* Remove the sign - remember if it is negative. */
-    if (PyUnicode_READ(kind, data, index) == '-') {
+    if (len > 0 && PyUnicode_READ(kind, data, index) == '-') {
         negative = true;
         index += 1;
         len -= 1;
     }
-    else if (PyUnicode_READ(kind, data, index) == '+') {
+    else if (len > 0 && PyUnicode_READ(kind, data, index) == '+') {
         index += 1;
         len -= 1;
     }
 
     /* Anything longer than a length of 1 is not valid. */
-    if (len == 1) {
-        const Py_UCS4 u = (Py_UCS4) PyUnicode_READ(kind, data, index);
-        const double number = Py_UNICODE_TONUMERIC(u);
-        const long digit = Py_UNICODE_TODIGIT(u);
-        if (number > -1.0) {
-            if (digit > -1) {
-                return PyLong_FromLong(negative ? -digit : digit);
-            }
-            else {
-                return PyFloat_FromDouble(negative ? -number : number);
-            }
-        }
+    if (len != 1 ||
+            !lookup_numeric((Py_UCS4) PyUnicode_READ(kind, data, index),
+                            number)) {
+        return FN_UNICODE_INVALID;
+    }
+    if (negative && !(number->is_int && number->value == 0.0)) {
+        number->value = -number->value;  /* Ints have no negative zero. */
+    }
+    return FN_UNICODE_NUMBER;
+}
+
+
+/* The Python int or float a numeric character stands for. */
+static PyObject *
+UnicodeNumeric_to_PyNumber(const UnicodeNumeric *number)
+{
+    return number->is_int
+           ? PyLong_FromLong((long) number->value)
+           : PyFloat_FromDouble(number->value);
+}
+
+
+/* Obtain a PyLong or PyFloat from this unicode string assuming
+ * it is a single unicode non-decimal numeric character.
+ * Return NULL if not possible. Return Py_None not PyUnicode.
+ */
+PyObject *
+convert_PyUnicode_to_PyNumber(PyObject *input)
+{
+    UnicodeNumeric number;
+    switch (parse_unicode_character(input, &number)) {
+    case FN_UNICODE_NUMBER:
+        return UnicodeNumeric_to_PyNumber(&number);
+    case FN_UNICODE_INVALID:
+        return NULL;
+    default:
+        return Py_None;
     }
-    return NULL;
 }
 
 /* Return a number of the desired type from a (possibly signed)
@@ -77,10 +153,12 @@ PyObject *
 PyUnicodeCharacter_to_PyNumber(PyObject *obj, const PyNumberType type,
                                const Options *options)
 {
-    PyObject *number = convert_PyUnicode_to_PyNumber(obj);
-    PyObject *result = NULL;
+    UnicodeNumeric number;
 
-    if (number == NULL) {
+    switch (parse_unicode_character(obj, &number)) {
+    case FN_UNICODE_NOT_UNICODE:
+        return Py_None;  /* Indicates TypeError, not ValueError. */
+    case FN_UNICODE_INVALID:
         if (type == REAL || type == FLOAT) {
             SET_ERR_INVALID_FLOAT(options);
         }
@@ -88,57 +166,35 @@ PyUnicodeCharacter_to_PyNumber(PyObject *obj, const PyNumberType type,
             SET_ERR_INVALID_INT(options);
         }
         return NULL;
+    default:
+        break;
     }
-    else if (number != Py_None) {
-        switch (type) {
-        case REAL:
-            if (PyLong_Check(number)) {
-                result = number;
-                Py_INCREF(result);
-                break;
-            }
-            else if (PyFloat_is_Intlike(number)) {
-                result = PyNumber_Long(number);
-                break;
-            }
+
+    switch (type) {
+    case REAL:
+        if (number.is_int) {
+            return UnicodeNumeric_to_PyNumber(&number);
+        }
+        else if (number.is_intlike) {
+            return PyLong_FromDouble(number.value);
+        }
         /* Deliberate fall-through to FLOAT. */
 
-        case FLOAT:
-            result = PyNumber_Float(number);
-            break;
-
-        case INT:
-            if (PyLong_Check(number)) {
-                result = number;
-                Py_INCREF(result);
-            }
-            else {
-                SET_ERR_INVALID_INT(options);
-            }
-            break;
-
-        case FORCEINT:
-        case INTLIKE:
-        default:
-            if (PyLong_Check(number)) {
-                result = number;
-                Py_INCREF(result);
-                break;
-            }
-            else {
-                result = PyNumber_Long(number);
-                if (result == NULL) {
-                    PyErr_Clear();
-                    SET_ERR_INVALID_INT(options);
-                }
-            }
+    case FLOAT:
+        return PyFloat_FromDouble(number.value);
+
+    case INT:
+        if (number.is_int) {
+            return UnicodeNumeric_to_PyNumber(&number);
         }
+        SET_ERR_INVALID_INT(options);
+        return NULL;
 
-        Py_DECREF(number);
-        return result;
-    }
-    else {
-        return Py_None;  /* Indicates TypeError, not ValueError. */
+    case FORCEINT:
+    case INTLIKE:
+    default:
+        /* Numeric values are all finite, so always truncate. */
+        return PyLong_FromDouble(number.value);
     }
 }
 
@@ -148,39 +204,39 @@ PyUnicodeCharacter_to_PyNumber(PyObject *obj, const PyNumberType type,
 PyObject *
 PyUnicodeCharacter_is_number(PyObject *obj, const PyNumberType type)
 {
-    PyObject *number = convert_PyUnicode_to_PyNumber(obj);
+    UnicodeNumeric number;
     bool isok = false;
 
-    if (number == NULL) {
+    switch (parse_unicode_character(obj, &number)) {
+    case FN_UNICODE_NOT_UNICODE:
+        return Py_None;  /* Not unicode. */
+    case FN_UNICODE_INVALID:
         Py_RETURN_FALSE;
+    default:
+        break;
     }
-    else if (number != Py_None) {
-        switch (type) {
-        case REAL:
-        case FLOAT:
-            isok = PyLong_Check(number) || PyFloat_Check(number);
-            break;
-
-        case INT:
-            isok = PyLong_Check(number);
-            break;
-
-        case FORCEINT:
-        case INTLIKE:
-        default:
-            isok = PyLong_Check(number) || PyFloat_is_Intlike(number);
-            break;
-        }
-        Py_DECREF(number);
-        if (isok) {
-            Py_RETURN_TRUE;
-        }
-        else {
-            Py_RETURN_FALSE;
-        }
+
+    switch (type) {
+    case REAL:
+    case FLOAT:
+        isok = true;
+        break;
+
+    case INT:
+        isok = number.is_int;
+        break;
+
+    case FORCEINT:
+    case INTLIKE:
+    default:
+        isok = number.is_int || number.is_intlike;
+        break;
+    }
+    if (isok) {
+        Py_RETURN_TRUE;
     }
     else {
-        return Py_None;  /* Not unicode. */
+        Py_RETURN_FALSE;
     }
 }
 
@@ -188,18 +244,18 @@ PyUnicodeCharacter_is_number(PyObject *obj, const PyNumberType type)
 PyObject *
 PyUnicodeCharacter_contains_type(PyObject *obj)
 {
-    PyObject *number = convert_PyUnicode_to_PyNumber(obj);
-    PyObject *retval = NULL;
+    UnicodeNumeric number;
+    PyObject *type = NULL;
 
-    if (number == NULL) {
-        return PyObject_Type(obj);
-    }
-    else if (number != Py_None) {
-        retval = PyObject_Type(number);
-        Py_DECREF(number);
-        return retval;
-    }
-    else {
+    switch (parse_unicode_character(obj, &number)) {
+    case FN_UNICODE_NOT_UNICODE:
         return Py_None;  /* Not unicode. */
+    case FN_UNICODE_INVALID:
+        return PyObject_Type(obj);
+    default:
+        type = number.is_int ? (PyObject *) &PyLong_Type
+                             : (PyObject *) &PyFloat_Type;
+        Py_INCREF(type);
+        return type;
     }
 }
@@ -1,10 +1,17 @@
 # -*- coding: utf-8 -*-
 # Find the build location and add that to the path
+import decimal
 import math
+import os
+import pickle
 import random
 import re
+import struct
+import subprocess
 import sys
+import sysconfig
 import unicodedata
+from concurrent.futures import ThreadPoolExecutor
 from functools import partial
 from typing import (
     Any,
@@ -13,6 +20,7 @@ from typing import (
     Iterable,
     List,
     NoReturn,
+    Tuple,
     Union,
 )
 
@@ -310,6 +318,170 @@ def test_version() -> None:
     assert hasattr(fastnumbers, "__version__")
 
 
+def test_kernels() -> None:
+    assert fastnumbers.kernels in ("avx2", "sse2", "scalar")
+
+
+@mark.parametrize("name", ["scalar", "bogus"])
+def test_kernels_can_be_forced_from_the_environment(name: str) -> None:
+    env = dict(os.environ, FASTNUMBERS_KERNELS=name)
+    code = "import fastnumbers; print(fastnumbers.kernels)"
+    result = subprocess.run(
+        [sys.executable, "-c", code], env=env, capture_output=True, text=True
+    )
+    if name == "bogus":
+        assert result.returncode != 0
+        assert "ValueError" in result.stderr
+    else:
+        assert result.stdout.strip() == name
+
+
+def test_kernels_are_chosen_once_per_process() -> None:
+    # A later import (e.g. in another interpreter) must not switch the
+    # kernels that other threads may be using, whatever the environment.
+    code = """
+import importlib.util, os
+import fastnumbers
+os.environ["FASTNUMBERS_KERNELS"] = "bogus"
+spec = importlib.util.find_spec("fastnumbers.fastnumbers")
+module = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(module)
+assert module is not fastnumbers.fastnumbers
+print(module.kernels == fastnumbers.kernels)
+"""
+    env = dict(os.environ, PYTHONPATH=os.pathsep.join(sys.path))
+    env.pop("FASTNUMBERS_KERNELS", None)
+    result = subprocess.run(
+        [sys.executable, "-c", code], env=env, capture_output=True, text=True
+    )
+    assert result.stdout.strip() == "True", result.stderr
+
+
+def test_scratch_space_is_reused_between_calls() -> None:
+    def parse_in_thread() -> List[int]:
+        x = "٣" * 30 + "_" + "1" * 100 + " "
+        counts = []
+        for _ in range(5):
+            assert fastnumbers.fast_int(x) == int(x)
+            assert fastnumbers.fast_int(" " + "1" * 100) == int("1" * 100)
+            counts.append(fastnumbers.scratch_allocations())
+        return counts
+
+    # Each thread has its own scratch space.
+    with ThreadPoolExecutor(max_workers=1) as executor:
+        counts = executor.submit(parse_in_thread).result()
+    assert counts[0] > 0
+    assert counts == [counts[0]] * len(counts)
+
+
+def test_each_module_has_its_own_types() -> None:
+    # Each import (as in each interpreter) gets a module with its own state.
+    spec = fastnumbers.fastnumbers.__spec__  # type: ignore
+    other = spec.loader.create_module(spec)
+    spec.loader.exec_module(other)
+    assert other.InvalidNumberError is not fastnumbers.InvalidNumberError
+    assert issubclass(other.InvalidNumberError, ValueError)
+    with raises(other.InvalidNumberError):
+        other.fast_int("bad", raise_on_invalid=True)
+    with raises(other.InvalidNumberError):
+        other.Converter("float", raise_on_invalid=True)("bad")
+    with raises(fastnumbers.InvalidNumberError):
+        fastnumbers.fast_int("bad", raise_on_invalid=True)
+
+
+def test_threads_can_share_inputs_and_errors() -> None:
+    values = [str(i) for i in range(1000)] + ["bad"]
+    with raises(fastnumbers.InvalidNumberError) as e:
+        fastnumbers.fast_float("bad", raise_on_invalid=True)
+    error = e.value  # Its message is formatted by whichever thread is first.
+
+    def convert_and_format(_: int) -> Tuple[List[Any], List[Any], str]:
+        floats = [fastnumbers.fast_float(x) for x in values]
+        ints = list(map(fastnumbers.Converter("int", default=-1), values))
+        return floats, ints, str(error)
+
+    with ThreadPoolExecutor(max_workers=8) as executor:
+        results = list(executor.map(convert_and_format, range(32)))
+    expected_ints: List[Any] = list(range(1000)) + [-1]
+    for floats, ints, message in results:
+        assert floats[:-1] == [float(i) for i in range(1000)]
+        assert floats[-1] == "bad"
+        assert ints == expected_ints
+        assert message == "could not convert string to float: 'bad'"
+
+
+@skipif(
+    not sysconfig.get_config_var("Py_GIL_DISABLED"),
+    reason="only free-threaded builds can run without the GIL",
+)
+def test_import_leaves_the_gil_disabled() -> None:
+    code = "import fastnumbers, sys; print(sys._is_gil_enabled())"
+    env = dict(os.environ, PYTHONPATH=os.pathsep.join(sys.path))
+    env.pop("PYTHON_GIL", None)
+    result = subprocess.run(
+        [sys.executable, "-W", "error", "-c", code],
+        env=env,
+        capture_output=True,
+        text=True,
+    )
+    assert result.stdout.strip() == "False", result.stderr
+
+
+SUBINTERPRETER_CODE = """
+import sys
+try:
+    import _interpreters as api
+    interp = api.create("isolated")
+except ImportError:
+    import _xxsubinterpreters as api
+    interp = api.create(isolated=True)
+error = api.run_string(interp, sys.argv[1])
+assert error is None, error.formatted
+api.destroy(interp)
+print("ok")
+"""
+
+SUBINTERPRETER_TEST = """
+import sys
+sys.path[:0] = {path!r}
+import fastnumbers
+assert fastnumbers.fast_float("1.5") == 1.5
+try:
+    fastnumbers.fast_int("bad", raise_on_invalid=True)
+except fastnumbers.InvalidNumberError as e:
+    assert e.input == "bad"
+else:
+    raise AssertionError("not raised")
+"""
+
+
+@skipif(sys.version_info < (3, 12), reason="needs interpreters with their own GIL")
+def test_can_be_imported_in_an_isolated_subinterpreter() -> None:
+    test = SUBINTERPRETER_TEST.format(path=sys.path)
+    result = subprocess.run(
+        [sys.executable, "-c", SUBINTERPRETER_CODE, test],
+        capture_output=True,
+        text=True,
+    )
+    assert result.stdout.strip() == "ok", result.stderr
+
+
+def test_every_unicode_numeral_matches_unicodedata() -> None:
+    # Numerals are looked up in a generated table, so check all of them.
+    for x in numeric:
+        value = unicodedata.numeric(x)
+        if x in digits:
+            expected: FloatOrInt = unicodedata.digit(x)
+        else:
+            expected = value
+        for sign in ("", "-"):
+            signed = -expected if sign else expected
+            assert fastnumbers.fast_float(sign + x) == float(signed), x
+            assert fastnumbers.fast_forceint(sign + x) == int(signed), x
+            assert fastnumbers.isint(sign + x) == (x in digits), x
+            assert fastnumbers.query_type(sign + x) is type(expected), x
+
+
 @given(floats(allow_nan=False) | integers())
 def test_real_returns_same_as_fast_real(x: FloatOrInt) -> None:
     assert fastnumbers.real(x) == fastnumbers.fast_real(x)
@@ -337,6 +509,27 @@ class TestArguments:
         with raises(TypeError):
             func()  # type: ignore
 
+    @parametrize("func", get_funcs(funcs), ids=funcs)
+    def test_duplicate_argument_raises_type_error(self, func: NonBuiltinFuncs) -> None:
+        with raises(TypeError):
+            func(5, x=5)  # type: ignore
+
+    def test_keywords_built_at_runtime_are_accepted(self) -> None:
+        kwargs = {"".join(["de", "fault"]): 7}
+        assert fastnumbers.fast_float("bad", **kwargs) == 7
+        assert fastnumbers.fast_int("ff", **{"".join(["ba", "se"]): 16}) == 255
+
+    @skipif(sys.version_info < (3, 7), reason="float takes x= before Python 3.7")
+    def test_positional_only_argument_given_by_keyword_raises_type_error(
+        self,
+    ) -> None:
+        with raises(TypeError):
+            fastnumbers.float(x="5")  # type: ignore
+
+    def test_query_type_coerce_false_is_respected(self) -> None:
+        assert fastnumbers.query_type("1.0", coerce=False) is float
+        assert fastnumbers.query_type("1.0", coerce=True) is int
+
 
 class TestBackwardsCompatibility:
 
@@ -381,6 +574,253 @@ class TestUnderscores:
         assert fastnumbers.query_type(x, allow_underscores=True) is int
         assert fastnumbers.query_type(x, allow_underscores=False) is str
 
+    @parametrize(
+        "x",
+        [
+            "1_0.5_0e1_0",
+            "1_0_0.0",
+            "1_" * 25 + "1",
+            "1_" * 1000 + "1",
+            "1__0",
+            "_10",
+            "10_",
+            "1_.5",
+            "1._5",
+            "1e_5",
+            "1_e5",
+            "0_0",
+        ],
+    )
+    def test_underscores_follow_python_grammar(self, x: str) -> None:
+        for func, builtin in [
+            (fastnumbers.fast_float, float),
+            (fastnumbers.fast_int, int),
+        ]:
+            for value in (x, "-" + x):
+                try:
+                    expected = builtin(value)
+                except ValueError:
+                    expected = value
+                assert func(value) == expected
+
+    @given(integers(min_value=0), sampled_from([2, 8, 16, 36]))
+    def test_underscores_in_based_int_follow_python_grammar(
+        self, x: int, base: int
+    ) -> None:
+        digits = ""
+        while True:
+            x, d = divmod(x, base)
+            digits = "0123456789abcdefghijklmnopqrstuvwxyz"[d] + digits
+            if not x:
+                break
+        s = "_".join(digits[i : i + 3] for i in range(0, len(digits), 3))
+        if base != 36:
+            s = "0" + {2: "b", 8: "o", 16: "x"}[base] + "_" + s
+            assert fastnumbers.fast_int(s, base=0) == int(s, 0)
+        assert fastnumbers.fast_int(s, base=base) == int(s, base)
+        assert fastnumbers.isint(s, base=base)
+
+
+class TestTrusted:
+    """Tests that trusted input is converted as if it were not trusted."""
+
+    funcs = conversion_funcs
+
+    @given(
+        floats(allow_nan=False, allow_infinity=False).map(repr)
+        | integers().map(repr)
+        | floats(allow_nan=False, allow_infinity=False).map("{:.25e}".format)
+    )
+    @parametrize("func", get_funcs(funcs), ids=funcs)
+    def test_canonical_input_converted_as_untrusted(
+        self, func: ConversionFuncs, x: str
+    ) -> None:
+        expected = func(x)
+        result = func(x, trusted=True)
+        assert result == expected
+        assert type(result) is type(expected)
+        assert func(x.encode(), trusted=True) == func(x.encode())
+
+    @given(text() | binary())
+    @parametrize("func", get_funcs(funcs), ids=funcs)
+    def test_other_input_is_read_safely(self, func: ConversionFuncs, x: str) -> None:
+        func(x, trusted=True)
+
+    def test_fast_int_with_base_is_not_affected(self) -> None:
+        assert fastnumbers.fast_int(" ff ", base=16, trusted=True) == 255
+
+
+class TestInvalidNumberError:
+    """Tests that invalid numbers raise errors just like Python's."""
+
+    @given(text() | binary())
+    @example("12x")
+    @example(b" 1.2.3 ")
+    @example("'")
+    def test_messages_match_python(self, x: Union[str, bytes]) -> None:
+        for func, builtin in [
+            (fastnumbers.float, float),
+            (fastnumbers.int, int),
+            (partial(fastnumbers.int, base=16), partial(int, base=16)),
+        ]:
+            try:
+                expected = builtin(x)
+            except ValueError as e:
+                with raises(fastnumbers.InvalidNumberError) as result:
+                    func(x)
+                assert isinstance(result.value, ValueError)
+                assert str(result.value) == str(e)
+                assert result.value.args == e.args
+                assert repr(result.value).endswith(repr(e)[len("ValueError") :])
+            else:
+                assert func(x) == expected
+
+    def test_input_and_base_are_kept(self) -> None:
+        with raises(fastnumbers.InvalidNumberError) as e:
+            fastnumbers.fast_int("12x", base=8, raise_on_invalid=True)
+        assert e.value.input == "12x"
+        assert e.value.base == 8
+        with raises(fastnumbers.InvalidNumberError) as e:
+            fastnumbers.fast_float("12x", raise_on_invalid=True)
+        assert e.value.input == "12x"
+        assert e.value.base is None
+
+    def test_can_be_pickled(self) -> None:
+        with raises(fastnumbers.InvalidNumberError) as e:
+            fastnumbers.float("12x")
+        result = pickle.loads(pickle.dumps(e.value))
+        assert type(result) is fastnumbers.InvalidNumberError
+        assert result.args == ("could not convert string to float: '12x'",)
+
+    def test_message_is_of_input_when_raised(self) -> None:
+        x = bytearray(b"12x")
+        with raises(fastnumbers.InvalidNumberError) as e:
+            fastnumbers.int(x)
+        x[:] = b"99y"
+        assert str(e.value) == "invalid literal for int() with base 10: {!r}".format(
+            bytearray(b"12x")
+        )
+
+    def test_args_can_be_replaced(self) -> None:
+        with raises(fastnumbers.InvalidNumberError) as e:
+            fastnumbers.float("12x")
+        e.value.args = ("other",)
+        assert str(e.value) == "other"
+        assert fastnumbers.InvalidNumberError("other").input is None
+
+
+class TestConverter:
+    """Tests that converters behave as the functions they stand for."""
+
+    options = [
+        ("real", {}),
+        ("real", {"coerce": False, "inf": 0.0, "nan": None}),
+        ("float", {"default": None, "precision": "fast"}),
+        ("float", {"on_fail": len, "allow_underscores": False}),
+        ("int", {"base": 16}),
+        ("int", {"default": -1, "trusted": True}),
+        ("forceint", {"on_fail": str.upper}),
+    ]
+
+    @given(text() | binary() | floats() | integers())
+    @parametrize("kind, options", options)
+    def test_results_match_function(
+        self, kind: str, options: Dict[str, Any], x: Any
+    ) -> None:
+        func = getattr(fastnumbers, "fast_" + kind)
+        try:
+            expected = func(x, **options)
+        except (TypeError, ValueError) as e:
+            with raises(type(e)):
+                fastnumbers.Converter(kind, **options)(x)
+        else:
+            result = fastnumbers.Converter(kind, **options)(x)
+            if expected != expected:
+                assert result != result
+            else:
+                assert result == expected
+            assert type(result) is type(expected)
+
+    def test_raise_on_invalid(self) -> None:
+        convert = fastnumbers.Converter("int", base=8, raise_on_invalid=True)
+        assert convert.kind == "int"
+        assert convert("17") == 15
+        with raises(fastnumbers.InvalidNumberError) as e:
+            convert("18")
+        assert e.value.base == 8
+
+    def test_options_are_kept_alive(self) -> None:
+        convert = fastnumbers.Converter("float", on_fail=lambda x: x * 2)
+        assert convert("ab") == "abab"
+
+    @parametrize(
+        "kind, option",
+        [
+            ("int", "inf"),
+            ("forceint", "precision"),
+            ("float", "coerce"),
+            ("real", "base"),
+        ],
+    )
+    def test_options_of_other_kinds_raise_type_error(
+        self, kind: str, option: str
+    ) -> None:
+        with raises(TypeError, match=option):
+            fastnumbers.Converter(kind, **{option: 0})
+
+    def test_invalid_options_raise_errors(self) -> None:
+        with raises(ValueError):
+            fastnumbers.Converter("complex")
+        with raises(ValueError):
+            fastnumbers.Converter("int", base=37)
+        with raises(ValueError):
+            fastnumbers.Converter("float", precision="slow")
+        with raises(TypeError):
+            fastnumbers.Converter("float", None)  # type: ignore
+
+    @given(lists(text() | binary() | floats() | integers(), max_size=200))
+    @parametrize("kind, options", options)
+    def test_map_matches_calls(
+        self, kind: str, options: Dict[str, Any], x: List[Any]
+    ) -> None:
+        convert = fastnumbers.Converter(kind, **options)
+        try:
+            expected = [convert(y) for y in x]
+        except (TypeError, ValueError) as e:
+            with raises(type(e)):
+                convert.map(x)
+        else:
+            result = convert.map(x)
+            assert [(type(y), repr(y)) for y in result] == [
+                (type(y), repr(y)) for y in expected
+            ]
+
+    def test_map_converts_many_mixed_inputs_in_order(self) -> None:
+        # Long enough for several blocks, each parsed without the GIL.
+        x = ["1", b" 2.5 ", 3, "4e2", "x", "\u0663", bytearray(b"7"), "9" * 50] * 500
+        convert = fastnumbers.Converter("real", default=None)
+        assert convert.map(iter(x)) == [convert(y) for y in x]
+        assert convert.map([]) == []
+
+    def test_map_raises_the_first_error(self) -> None:
+        convert = fastnumbers.Converter("int", raise_on_invalid=True)
+        with raises(fastnumbers.InvalidNumberError) as e:
+            convert.map(["1"] * 2000 + ["1.5", "x"])
+        assert e.value.input == "1.5"
+        with raises(ZeroDivisionError):
+            fastnumbers.Converter("float", on_fail=lambda x: 1 / 0).map(["1", "x"])
+        with raises(TypeError):
+            convert.map(None)  # type: ignore
+
+    def test_takes_exactly_one_argument(self) -> None:
+        convert = fastnumbers.Converter("float")
+        with raises(TypeError):
+            convert()  # type: ignore
+        with raises(TypeError):
+            convert("1", "2")  # type: ignore
+        with raises(TypeError):
+            convert(x="1")  # type: ignore
+
 
 class TestErrorHandlingConversionFunctionsSuccessful:
     """
@@ -561,6 +1001,53 @@ class TestErrorHandlingConversionFunctionsSuccessful:
         assert isinstance(func(x), float)
         assert func(pad(x)) == expected  # Accepts padding as well
 
+    @parametrize(
+        "x",
+        [
+            "\xa01.5\xa0",
+            " -12 ",
+            "　+1e-5　",
+            "\U0001d7ce\U0001d7cf",
+            "١٢٣",
+            "12３",
+            "1" * 70 + " ",
+            " " + "9" * 20 + ".5",
+            "\u2007" + "1" * 100 + "\u2007",
+            "\U0001d7d7" * 30,
+        ],
+    )
+    def test_given_number_with_unicode_whitespace_or_digits_returns_number(
+        self, x: str
+    ) -> None:
+        expected = float(x) if any(c in x for c in ".e") else int(x)
+        assert fastnumbers.fast_real(x) == expected
+        assert type(fastnumbers.fast_real(x)) is type(expected)
+
+    # Slices of a buffer are parsed without looking past the slice.
+
+    funcs = conversion_funcs
+
+    @parametrize(
+        "data, start, stop, expected",
+        [
+            (b"12345", 1, 3, 23),
+            (b" 12 34", 0, 3, 12),
+            (b"1_000", 0, 3, 10),
+            (b"-7.5", 0, 2, -7),
+            (b"1e5", 0, 1, 1),
+        ],
+    )
+    @parametrize("func", get_funcs(funcs), ids=funcs)
+    def test_given_memoryview_slice_returns_number_in_slice(
+        self,
+        func: ConversionFuncs,
+        data: bytes,
+        start: int,
+        stop: int,
+        expected: int,
+    ) -> None:
+        assert func(memoryview(data)[start:stop]) == expected
+
     # Tests to ensure correct evaluation is always the first priority.
 
     funcs = conversion_funcs
@@ -745,11 +1232,32 @@ class TestFastReal:
     def test_given_float_string_returns_int_with_coerce_with_intlike(
         self, x: str
     ) -> None:
-        expected = int(float(x))
+        expected = int(decimal.Decimal(x))
         result = fastnumbers.fast_real(x, coerce=True)
         assert result == expected
         assert isinstance(result, int)
 
+    @parametrize(
+        "x, expected",
+        [
+            ("123456789012345678.0", 123456789012345678),
+            ("-1234567890123456789012345.6e1", -12345678901234567890123456),
+            ("1.5e300", 15 * 10**299),
+        ],
+    )
+    def test_given_large_intlike_float_string_returns_exact_int_with_coerce(
+        self, x: str, expected: int
+    ) -> None:
+        result = fastnumbers.fast_real(x, coerce=True)
+        assert result == expected
+        assert isinstance(result, int)
+
+    def test_given_intlike_float_string_too_large_for_a_float_returns_inf(
+        self,
+    ) -> None:
+        assert fastnumbers.fast_real("1e400", coerce=True) == math.inf
+        assert fastnumbers.fast_real("9" * 400 + ".0", coerce=True) == math.inf
+
 
 class TestFastFloat:
     """
@@ -764,6 +1272,84 @@ class TestFastFloat:
             val = "1.0000000000E{0:d}".format(x)
             assert fastnumbers.fast_float(val) == float(val)
 
+    @given(floats(allow_nan=False, allow_infinity=False))
+    @parametrize("fmt", ["{!r}", "{:.17e}", "{:.20e}", "{:.40g}"])
+    def test_given_long_mantissa_correctly_rounds(self, fmt: str, x: float) -> None:
+        val = fmt.format(x)
+        assert fastnumbers.fast_float(val) == float(val)
+
+    @given(
+        integers(2 ** 52, 2 ** 53 - 1), integers(-1126, 970), sampled_from([-1, 0, 1])
+    )
+    def test_given_long_string_near_halfway_correctly_rounds(
+        self, mantissa: int, exponent: int, offset: int
+    ) -> None:
+        # The exact midpoint of two doubles (or a hair either side of it)
+        # cannot be decided from the first 19 digits.
+        with decimal.localcontext() as ctx:
+            ctx.prec = 800
+            mid = decimal.Decimal(2 * mantissa + 1)
+            mid *= decimal.Decimal(2) ** (exponent - 1)
+            mid += offset * mid / 10 ** 40
+            val = "{:e}".format(mid)
+        assert fastnumbers.fast_float(val) == float(val)
+
+    @given(
+        integers(2 ** 52, 2 ** 53 - 1), integers(-1126, 970), sampled_from([-1, 0, 1])
+    )
+    def test_given_long_string_near_halfway_with_fast_precision_is_within_one_ulp(
+        self, mantissa: int, exponent: int, offset: int
+    ) -> None:
+        with decimal.localcontext() as ctx:
+            ctx.prec = 800
+            mid = decimal.Decimal(2 * mantissa + 1)
+            mid *= decimal.Decimal(2) ** (exponent - 1)
+            mid += offset * mid / 10 ** 40
+            val = "{:e}".format(mid)
+        expected = struct.unpack("<q", struct.pack("<d", float(val)))[0]
+        result = fastnumbers.fast_float(val, precision="fast")
+        assert abs(struct.unpack("<q", struct.pack("<d", result))[0] - expected) <= 1
+        assert fastnumbers.fast_real(val, coerce=False, precision="fast") == result
+
+    @given(floats(allow_nan=False, allow_infinity=False).map(repr))
+    def test_given_short_mantissa_with_fast_precision_is_exact(self, x: str) -> None:
+        assert fastnumbers.fast_float(x, precision="fast") == float(x)
+
+    @parametrize("func", [fastnumbers.fast_float, fastnumbers.fast_real])
+    def test_given_invalid_precision_raises_value_error(
+        self, func: Callable[..., Any]
+    ) -> None:
+        with raises(ValueError, match=r"^precision must be 'exact' or 'fast'"):
+            func("1.5", precision="approximate")
+        assert func("1.5", precision="exact") == 1.5
+
+    @parametrize(
+        "x",
+        [
+            "2.2250738585072011e-308",  # Largest subnormal
+            "2.2250738585072012e-308",  # Smallest normal
+            "4.9406564584124654e-324",  # Smallest subnormal
+            "2.4703282292062327e-324",  # Just below half the smallest subnormal
+            "2.4703282292062328e-324",  # Just above half the smallest subnormal
+            "1.7976931348623157e308",  # Largest double
+            "1.7976931348623159e308",  # Rounds to infinity
+            "9007199254740993",  # Halfway between two doubles
+            "2.00000000000000011102230246251565404236316680908203125",  # Tie
+            "2.00000000000000011102230246251565404236316680908203124",
+            "2.00000000000000011102230246251565404236316680908203126",
+            "1e23",
+            "1" + "0" * 400,
+            "0." + "0" * 400 + "1",
+            "-0.0",
+            "0e999",
+        ],
+    )
+    def test_given_hard_to_round_string_matches_builtin(self, x: str) -> None:
+        expected = float(x)
+        result = fastnumbers.fast_float(x)
+        assert result == expected
+        assert math.copysign(1.0, result) == math.copysign(1.0, expected)
+
     @given(integers())
     def test_given_int_returns_float(self, x: int) -> None:
         expected = float(x)
@@ -828,6 +1414,75 @@ class TestFastInt:
         # Force unicode path
         assert fastnumbers.fast_int(hex(x).replace("0", "\uFF10"), base=0) == x
 
+    @parametrize(
+        "x", ["9" * 25 + "\xa0", "\xa0-" + "9" * 25, "\u3000" + "9" * 25 + "\u3000"]
+    )
+    def test_given_long_int_string_with_unicode_whitespace_and_base(
+        self, x: str
+    ) -> None:
+        assert fastnumbers.fast_int(x, base=0) == int(x, 0)
+        assert fastnumbers.fast_int(x, base=16) == int(x, 16)
+
+    @given(integers(min_value=-(10 ** 40), max_value=10 ** 40))
+    @example(2 ** 63)
+    @example(-(2 ** 63) - 1)
+    @example(2 ** 64)
+    @example(-(2 ** 64) + 1)
+    @example(10 ** 38 - 1)
+    @example(-(10 ** 38))
+    def test_given_wide_int_string_returns_exact_int(self, x: int) -> None:
+        # Straddles the 64-bit and 128-bit limits of the native parser.
+        assert fastnumbers.fast_int(str(x)) == x
+        assert fastnumbers.fast_int("000" + str(abs(x))) == abs(x)
+        assert fastnumbers.fast_int(str(x) + "x") == str(x) + "x"
+
+    @parametrize("ndigits", [39, 640, 4300, 19456, 19457, 50000])
+    def test_given_very_long_int_string_returns_exact_int(self, ndigits: int) -> None:
+        x = "".join(random.choice("0123456789") for _ in range(ndigits))
+        limit = getattr(sys, "get_int_max_str_digits", lambda: 0)()
+        if limit:
+            sys.set_int_max_str_digits(0)
+        try:
+            assert fastnumbers.fast_int(x) == int(x)
+            assert fastnumbers.fast_int("-" + x) == -int(x)
+        finally:
+            if limit:
+                sys.set_int_max_str_digits(limit)
+
+    @mark.skipif(
+        not hasattr(sys, "set_int_max_str_digits"), reason="no int digit limit"
+    )
+    def test_given_int_string_over_digit_limit_returns_as_is(self) -> None:
+        x = "1" * (sys.get_int_max_str_digits() + 1)
+        assert fastnumbers.fast_int(x) is x
+        with raises(ValueError, match="Exceeds the limit"):
+            fastnumbers.fast_int(x, raise_on_invalid=True)
+
+    @parametrize(
+        "x, base",
+        [
+            ("8", 8),
+            ("2", 2),
+            ("g", 16),
+            ("0x_", 16),
+            ("0b_1", 16),
+            ("0_x7", 16),
+            ("0_b11_1", 36),
+            ("x_yz", 36),
+            ("-0o_7", 0),
+            ("0_0", 0),
+            ("0x" + "f" * 17, 16),
+            ("-0b1" + "0" * 64, 2),
+        ],
+    )
+    def test_given_string_in_base_matches_int(self, x: str, base: int) -> None:
+        try:
+            expected: Union[int, str] = int(x, base)
+        except ValueError:
+            expected = x
+        assert fastnumbers.fast_int(x, base=base) == expected
+        assert fastnumbers.isint(x, base=base) is isinstance(expected, int)
+
     @parametrize("zero", ["0", "\uFF10"])
     @parametrize("base", [0, 2, 8, 18])
     def test_given_multiple_zeros_with_base_returns_zero(
@@ -847,12 +1502,29 @@ class TestFastForceInt:
 
     @given(floats(allow_nan=False, allow_infinity=False))
     def test_given_float_string_returns_int(self, x: float) -> None:
-        expected = int(x)
+        expected = int(decimal.Decimal(repr(x)))
         result = fastnumbers.fast_forceint(repr(x))
         assert result == expected
         assert isinstance(result, int)
         assert fastnumbers.fast_forceint(pad(repr(x))) == expected  # Accepts padding
 
+    @parametrize(
+        "x, expected",
+        [
+            ("123456789012345678.9", 123456789012345678),
+            ("-1234567890123456789012345.6e5", -123456789012345678901234560000),
+            ("0.99999999999999999999", 0),
+            ("1_2.3_4e1_0", 123400000000),
+            ("_".join(["1234567890"] * 4) + "e3", int("1234567890" * 4) * 10**3),
+            ("1e308", 10**308),
+            ("1e-400", 0),
+        ],
+    )
+    def test_given_float_string_is_truncated_exactly(
+        self, x: str, expected: int
+    ) -> None:
+        assert fastnumbers.fast_forceint(x) == expected
+
     @given(sampled_from(numeric))
     def test_given_unicode_numeral_returns_int(self, x: str) -> None:
         expected = int(unicodedata.numeric(x))
@@ -900,6 +1572,25 @@ class TestCheckingFunctions:
         assert not func(x)
         assert func(x, allow_inf=True)
 
+    # Slices of a buffer are checked without looking past the slice.
+
+    @parametrize(
+        "data, stop, expected",
+        [
+            (b"12x", 2, [True, True, True, True]),
+            (b"1.5", 2, [True, True, False, True]),
+            (b"1e5", 2, [False, False, False, False]),
+            (b"0x1f", 3, [False, False, False, False]),
+            (b"1_0", 2, [False, False, False, False]),
+        ],
+    )
+    def test_given_memoryview_slice_checks_only_the_slice(
+        self, data: bytes, stop: int, expected: List[bool]
+    ) -> None:
+        view = memoryview(data)[:stop]
+        funcs = get_funcs(identification_funcs)
+        assert [func(view) for func in funcs] == expected
+
     # Handling of numeric objects as input
 
     funcs = ["isreal", "isint", "isintlike"]
@@ -1034,6 +1725,33 @@ class TestIsFloat:
     def test_returns_false_if_given_int(self, x: int) -> None:
         assert not fastnumbers.isfloat(x)
 
+    @parametrize(
+        "x, expected",
+        [
+            ("1.", True),
+            (".5", True),
+            ("1.e5", True),
+            ("1.5E-05", True),
+            ("1e+5", True),
+            ("0" * 40 + "1.5", True),
+            (".", False),
+            ("e5", False),
+            (".e5", False),
+            ("1e", False),
+            ("1e+", False),
+            ("1e5.", False),
+            ("1.5.", False),
+            ("1e5e", False),
+            ("1-5", False),
+            ("1+e5", False),
+            ("1e-+5", False),
+            ("1.5a", False),
+            ("1\x005", False),
+        ],
+    )
+    def test_grammar_edge_cases(self, x: str, expected: bool) -> None:
+        assert fastnumbers.isfloat(x) is expected
+
 
 class TestIsInt:
     """Tests for the isint function that are too specific for the generalized tests."""
@@ -1101,6 +1819,18 @@ class TestIsInt:
             if len(x) < 30:
                 assert not fastnumbers.isint(x, base=base)
 
+    @parametrize("bad", ["/", ":", "a", "\x00"])
+    def test_returns_false_if_any_character_of_long_int_is_not_a_digit(
+        self, bad: str
+    ) -> None:
+        # Digits are validated eight at a time, so probe every position.
+        for i in range(20):
+            x = "12345678901234567890"
+            x = x[:i] + bad + x[i + 1 :]
+            assert not fastnumbers.isint(x)
+            assert not fastnumbers.isfloat(x)
+            assert fastnumbers.fast_int(x) is x
+
     @given(sampled_from(numeric_not_digit_not_int))
     def test_given_unicode_numeral_returns_false(self, x: str) -> None:
         assert not fastnumbers.isint(x)
@@ -1139,6 +1869,24 @@ class TestIsIntLike:
         assert fastnumbers.isintlike(x)
         assert fastnumbers.isintlike(pad(x))  # Accepts padding
 
+    @parametrize(
+        "x, expected",
+        [
+            ("1e99999", True),
+            ("1.5e40000", True),
+            ("31e-99999", False),
+            # The digits cancel out an exponent too large on its own.
+            ("1" + "0" * 655360 + "e-655360", True),
+            ("0." + "0" * 655360 + "1e655361", True),
+        ],
+    )
+    def test_given_huge_exponent_string_returns_correctly(
+        self, x: str, expected: bool
+    ) -> None:
+        assert fastnumbers.fast_float(x) == float(x)
+        assert fastnumbers.isintlike(x) is expected
+        assert (fastnumbers.query_type(x, coerce=True) is int) is expected
+
 
 class TestQueryType:
     """Tests for the query_type function."""
@@ -38,7 +38,7 @@ def test_fast_real() -> None:
     assert fastnumbers.fast_real("+367.3268") == +367.3268
     assert fastnumbers.fast_real("+367.3268", raise_on_invalid=True) == +367.3268
     # 3. float string with exponents
-    assert fastnumbers.fast_real("-367.3268e207") == -367.3268e207
+    assert fastnumbers.fast_real("-367.3268e207") == -3673268 * 10**203
     assert fastnumbers.fast_real("1.175494351e-3810000000") == 0.0
     # 4. float string with padded whitespace
     assert fastnumbers.fast_real("   -367.04   ") == -367.04
@@ -237,7 +237,7 @@ def test_fast_forceint() -> None:
     assert fastnumbers.fast_forceint("+367.3268") == 367
     assert fastnumbers.fast_forceint("+367.3268", raise_on_invalid=True) == 367
     # 3. float string with exponents
-    assert fastnumbers.fast_forceint("-367.3268e207") == int(-367.3268e207)
+    assert fastnumbers.fast_forceint("-367.3268e207") == -3673268 * 10**203
     # 4. float string with padded whitespace
     assert fastnumbers.fast_forceint("   -367.04   ") == -367
     # 5. int number